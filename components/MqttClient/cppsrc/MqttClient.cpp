@@ -1,5 +1,7 @@
 #include "MqttClient.hpp"
-#include <vector>
+#include "esp_timer.h"
+#include <algorithm>
+#include <cstring>
 
 char MqttClient::TAG[] = "MqttClient";
 
@@ -7,7 +9,10 @@ esp_mqtt_client_config_t MqttClient::mqttConfig;
 eventHandleCallback* MqttClient::event_callback;
 
 MqttClient::MqttClient(std::string node_name) :
-        id{node_name}, connected{false}
+        id{node_name}, client{NULL}, started{false}, connected{false},
+        queueMaxLength{0}, queueHead{0}, queueCount{0},
+        queuePolicy{QueuePolicy::DropOldest}, droppedCount{0}, coalescedCount{0},
+        drainRate{0}, drainBurst{0}, drainTokens{0}, drainRefillTime{0}
 {
 }
 
@@ -45,7 +50,7 @@ esp_err_t MqttClient::initialize(std::string host_id,
     }
     if(esp_mqtt_client_register_event(client, 
                                       (esp_mqtt_event_id_t) ESP_EVENT_ANY_ID, 
-                                      MqttClient::mqtt_event_handler, client) != ESP_OK)
+                                      MqttClient::mqtt_event_handler, this) != ESP_OK)
     {
         ESP_LOGE(TAG, "MQTT register event");
         return ESP_ERR_INVALID_STATE;
@@ -55,7 +60,8 @@ esp_err_t MqttClient::initialize(std::string host_id,
         ESP_LOGE(TAG, "MQTT start client");
         return ESP_FAIL;
     }
-    connected = true;
+    // connected is set by MQTT_EVENT_CONNECTED
+    started = true;
     return ESP_OK;
 }
 
@@ -67,21 +73,22 @@ esp_err_t MqttClient::start()
         return ESP_FAIL;
     }
 
-    if(connected == true)
+    if(started == true)
     {
-        ESP_LOGI(TAG, "Already connected");
+        ESP_LOGI(TAG, "Already started");
         return ESP_ERR_INVALID_STATE;    
     }
 
     if(esp_mqtt_client_start(client) == ESP_OK)
     {
-        connected = true;
+        started = true;
         return ESP_OK;
     }
     return ESP_FAIL;
 }
 esp_err_t MqttClient::stop()
 {
+    started = false;
     connected = false;
     return esp_mqtt_client_stop(client);
 }
@@ -97,6 +104,11 @@ esp_err_t MqttClient::disconnect()
 }
 
 esp_err_t MqttClient::publish(std::string topic, std::string value, uint8_t qos, uint8_t retain_flag)
+{
+    return publish(topic, value.c_str(), value.size(), qos, retain_flag);
+}
+
+esp_err_t MqttClient::publish(std::string topic, const char *data, size_t length, uint8_t qos, uint8_t retain_flag)
 {
     std::string tpc = id;
     tpc.append("/");
@@ -105,7 +117,226 @@ esp_err_t MqttClient::publish(std::string topic, std::string value, uint8_t qos,
     {
         return ESP_ERR_INVALID_ARG;
     }
-    return (esp_err_t) esp_mqtt_client_publish(client, tpc.c_str(), value.c_str(), value.size(), qos, retain_flag);
+    return (esp_err_t) esp_mqtt_client_publish(client, tpc.c_str(), data, (int) length, qos, retain_flag);
+}
+
+esp_err_t MqttClient::publish(TopicId topic, const char *data, size_t length, uint8_t qos, uint8_t retain_flag)
+{
+    // the full topic was built by addTopic(), nothing is allocated here
+    if( (topic >= topics.size()) || (qos > 3) || (retain_flag > 1) )
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(queue.empty())
+    {
+        return esp_mqtt_client_publish(client, topics[topic].c_str(), data, (int) length, qos, retain_flag) >= 0 ? ESP_OK : ESP_FAIL;
+    }
+
+    // queued messages go first, new ones line up behind them
+    drain();
+    if(connected && (getQueuedCount() == 0))
+    {
+        if(esp_mqtt_client_publish(client, topics[topic].c_str(), data, (int) length, qos, retain_flag) >= 0)
+        {
+            return ESP_OK;
+        }
+    }
+    esp_err_t err = enqueue(topic, data, length, qos, retain_flag);
+    return err == ESP_OK ? ESP_ERR_NOT_FINISHED : err;
+}
+
+TopicId MqttClient::addTopic(std::string topic)
+{
+    if(client != NULL)
+    {
+        ESP_LOGE(TAG, "addTopic after init");
+        return INVALID_TOPIC;
+    }
+    std::string tpc = id;
+    tpc.append("/");
+    tpc.append(topic);
+    for(size_t i = 0; i < topics.size(); ++i)
+    {
+        if(topics[i] == tpc)
+        {
+            return (TopicId) i;
+        }
+    }
+    if(topics.size() >= INVALID_TOPIC)
+    {
+        return INVALID_TOPIC;
+    }
+    topics.push_back(tpc);
+    return (TopicId) (topics.size() - 1);
+}
+
+const char *MqttClient::getTopic(TopicId topic) const
+{
+    return topic < topics.size() ? topics[topic].c_str() : nullptr;
+}
+
+esp_err_t MqttClient::setOfflineQueue(size_t capacity, size_t max_length, QueuePolicy policy)
+{
+    if( (max_length > UINT16_MAX) || ((capacity == 0) != (max_length == 0)) )
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // all memory of the queue is taken here, it never grows afterwards
+    std::lock_guard<std::mutex> queueLock(queueMutex);
+    std::lock_guard<std::mutex> drainLock(drainMutex);
+    queue.assign(capacity, QueuedMessage{});
+    queue.shrink_to_fit();
+    queueData.assign(capacity * max_length, 0);
+    queueData.shrink_to_fit();
+    drainBuffer.assign(max_length, 0);
+    drainBuffer.shrink_to_fit();
+    queueMaxLength = max_length;
+    queueHead = 0;
+    queueCount = 0;
+    queuePolicy = policy;
+    return ESP_OK;
+}
+
+void MqttClient::setDrainRate(uint16_t messages_per_second, uint16_t burst)
+{
+    std::lock_guard<std::mutex> drainLock(drainMutex);
+    drainRate = messages_per_second;
+    drainBurst = burst > 0 ? burst : 1;
+    drainTokens = drainBurst;
+    drainRefillTime = esp_timer_get_time();
+}
+
+esp_err_t MqttClient::enqueue(TopicId topic, const char *data, size_t length, uint8_t qos, uint8_t retain_flag)
+{
+    if(length > queueMaxLength)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if(queueCount == queue.size())
+    {
+        if(queuePolicy == QueuePolicy::CoalesceByTopic)
+        {
+            for(size_t i = 0; i < queueCount; ++i)
+            {
+                size_t slot = (queueHead + i) % queue.size();
+                if(queue[slot].topic == topic)
+                {
+                    ESP_LOGW(TAG, "offline queue full, replaced a message of the same topic");
+                    queue[slot] = QueuedMessage{topic, qos, retain_flag, (uint16_t) length};
+                    memcpy(&queueData[slot * queueMaxLength], data, length);
+                    ++coalescedCount;
+                    return ESP_OK;
+                }
+            }
+        }
+        // the oldest message makes room, its slot is the one behind the newest
+        ESP_LOGW(TAG, "offline queue full, dropped the oldest message");
+        ++droppedCount;
+        queueHead = (queueHead + 1) % queue.size();
+        --queueCount;
+    }
+
+    size_t slot = (queueHead + queueCount) % queue.size();
+    queue[slot] = QueuedMessage{topic, qos, retain_flag, (uint16_t) length};
+    memcpy(&queueData[slot * queueMaxLength], data, length);
+    ++queueCount;
+    return ESP_OK;
+}
+
+bool MqttClient::takeDrainToken()
+{
+    if(drainRate == 0)
+    {
+        return true;
+    }
+
+    int64_t now = esp_timer_get_time();
+    int64_t earned = (now - drainRefillTime) * drainRate / 1000000;
+    if(earned > 0)
+    {
+        drainTokens = (uint16_t) std::min<int64_t>(drainBurst, drainTokens + earned);
+        drainRefillTime = now;
+    }
+    if(drainTokens == 0)
+    {
+        return false;
+    }
+    --drainTokens;
+    return true;
+}
+
+size_t MqttClient::drain()
+{
+    // one drain at a time, the others just leave
+    std::unique_lock<std::mutex> drainLock(drainMutex, std::try_to_lock);
+    if(!drainLock.owns_lock() || queue.empty())
+    {
+        return 0;
+    }
+
+    size_t sent = 0;
+    while(connected && (getQueuedCount() > 0) && takeDrainToken())
+    {
+        // the message is copied out, esp-mqtt may call back into
+        // mqtt_event_handler_cb while publishing
+        QueuedMessage message;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if(queueCount == 0)
+            {
+                break;
+            }
+            message = queue[queueHead];
+            memcpy(drainBuffer.data(), &queueData[queueHead * queueMaxLength], message.length);
+            queueHead = (queueHead + 1) % queue.size();
+            --queueCount;
+        }
+
+        if(esp_mqtt_client_publish(client, topics[message.topic].c_str(), drainBuffer.data(),
+                                   message.length, message.qos, message.retain_flag) < 0)
+        {
+            // back to the front, unless newer messages took its place
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if(queueCount < queue.size())
+            {
+                queueHead = (queueHead + queue.size() - 1) % queue.size();
+                queue[queueHead] = message;
+                memcpy(&queueData[queueHead * queueMaxLength], drainBuffer.data(), message.length);
+                ++queueCount;
+            }
+            else
+            {
+                ++droppedCount;
+            }
+            break;
+        }
+        ++sent;
+    }
+    return sent;
+}
+
+size_t MqttClient::getQueuedCount()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return queueCount;
+}
+
+uint32_t MqttClient::getDroppedCount() const
+{
+    return droppedCount;
+}
+
+uint32_t MqttClient::getCoalescedCount() const
+{
+    return coalescedCount;
+}
+
+bool MqttClient::isConnected() const
+{
+    return connected;
 }
 
 esp_err_t MqttClient::subscribe(std::string topic, uint8_t qos)
@@ -149,7 +380,7 @@ esp_err_t MqttClient::unsubscribe(std::string topic)
     }
 }
 
-esp_err_t MqttClient::mqtt_event_handler_cb(esp_mqtt_event_handle_t event)
+esp_err_t MqttClient::mqtt_event_handler_cb(MqttClient *mqtt, esp_mqtt_event_handle_t event)
 {
     esp_mqtt_client_handle_t client = event->client;
     int msg_id;
@@ -158,12 +389,17 @@ esp_err_t MqttClient::mqtt_event_handler_cb(esp_mqtt_event_handle_t event)
     {
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
+            mqtt->connected = true;
+            // the drain tokens filled up while offline, this starts with a burst
+            mqtt->drain();
             break;
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
+            mqtt->connected = false;
             break;
         case MQTT_EVENT_PUBLISHED:
             ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+            mqtt->drain();
             break;
         case MQTT_EVENT_SUBSCRIBED:
             ESP_LOGI(TAG, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
@@ -192,5 +428,5 @@ void MqttClient::mqtt_event_handler(void *handler_args,
                                     void *event_data)
 {
     ESP_LOGD(TAG, "Event dispatched from event loop base=%s, event_id=%d", base, (int) event_id);
-    MqttClient::event_callback((esp_mqtt_event_handle_t) event_data);
+    MqttClient::event_callback((MqttClient *) handler_args, (esp_mqtt_event_handle_t) event_data);
 }
@@ -1,16 +1,30 @@
 #ifndef MQTTCLIENT_HPP
 #define MQTTCLIENT_HPP
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
 #include "esp_log.h"
 #include "esp_types.h"
 #include "mqtt_client.h"
 
-typedef esp_err_t eventHandleCallback(esp_mqtt_event_handle_t);
+class MqttClient;
+typedef esp_err_t eventHandleCallback(MqttClient *, esp_mqtt_event_handle_t);
+typedef uint16_t TopicId;
 
 class MqttClient
 {
     public:
+    // what happens to a message published while the offline queue is full
+    enum class QueuePolicy
+    {
+        DropOldest,         // the oldest queued message is dropped
+        CoalesceByTopic     // a queued message of the same topic is replaced,
+                            // the oldest one dropped if there is none
+    };
+
     MqttClient(std::string node_name);
     esp_err_t initialize(const std::string host_id, 
                     const uint16_t port,
@@ -22,9 +36,24 @@ class MqttClient
     esp_err_t connect();
     esp_err_t disconnect();
     esp_err_t publish(std::string topic, std::string value, uint8_t qos=0, uint8_t retain_flag=0);
+    esp_err_t publish(std::string topic, const char *data, size_t length, uint8_t qos=0, uint8_t retain_flag=0);
+    // ESP_OK once handed to esp-mqtt, ESP_ERR_NOT_FINISHED if it waits in the
+    // offline queue, which is lost in deep sleep
+    esp_err_t publish(TopicId topic, const char *data, size_t length, uint8_t qos=0, uint8_t retain_flag=0);
+    // topics are fixed before initialize(), the MQTT task reads them while
+    // draining the queue; INVALID_TOPIC afterwards
+    TopicId addTopic(std::string topic);
+    const char *getTopic(TopicId topic) const;
+    esp_err_t setOfflineQueue(size_t capacity, size_t max_length, QueuePolicy policy = QueuePolicy::DropOldest);
+    void setDrainRate(uint16_t messages_per_second, uint16_t burst);
+    size_t drain();
+    size_t getQueuedCount();
+    uint32_t getDroppedCount() const;
+    uint32_t getCoalescedCount() const;
+    bool isConnected() const;
     esp_err_t subscribe(std::string topic, uint8_t qos);
     esp_err_t unsubscribe(std::string topic);
-    static esp_err_t mqtt_event_handler_cb(esp_mqtt_event_handle_t event);
+    static esp_err_t mqtt_event_handler_cb(MqttClient *mqtt, esp_mqtt_event_handle_t event);
     static void mqtt_event_handler(void *handler_args, 
                                     esp_event_base_t base, 
                                     int32_t event_id, 
@@ -35,6 +64,7 @@ class MqttClient
 
     static esp_mqtt_client_config_t mqttConfig;
     static eventHandleCallback *event_callback;
+    static constexpr TopicId INVALID_TOPIC = 0xffff;
 
     private:
     std::string id;
@@ -44,7 +74,38 @@ class MqttClient
     uint16_t port;
     uint16_t keepalive;
     esp_mqtt_client_handle_t client;
-    bool connected;
+    bool started;
+    std::atomic<bool> connected;
+    std::vector<std::string> topics;
+
+    // offline queue, a ring of fixed slots allocated by setOfflineQueue()
+    struct QueuedMessage
+    {
+        TopicId topic;
+        uint8_t qos;
+        uint8_t retain_flag;
+        uint16_t length;
+    };
+    std::mutex queueMutex;
+    std::vector<QueuedMessage> queue;
+    std::vector<char> queueData;
+    size_t queueMaxLength;
+    size_t queueHead;
+    size_t queueCount;
+    QueuePolicy queuePolicy;
+    std::atomic<uint32_t> droppedCount;
+    std::atomic<uint32_t> coalescedCount;
+
+    // drain rate limit, a token bucket
+    std::mutex drainMutex;
+    std::vector<char> drainBuffer;
+    uint16_t drainRate;
+    uint16_t drainBurst;
+    uint16_t drainTokens;
+    int64_t drainRefillTime;
+
+    esp_err_t enqueue(TopicId topic, const char *data, size_t length, uint8_t qos, uint8_t retain_flag);
+    bool takeDrainToken();
 };
 
 #endif // MQTTCLIENT_HPP
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "FakeMqtt.hpp"
+#include "esp_timer.h"
+
+struct esp_mqtt_client {
+    esp_event_handler_t *handler{nullptr};
+    void *handlerArgs{nullptr};
+};
+
+static esp_mqtt_client client;
+static bool brokerUp = false;
+static int64_t now = 0;
+static std::vector<std::string> published;
+
+void FakeMqtt::reset()
+{
+    client = esp_mqtt_client{};
+    brokerUp = false;
+    now = 0;
+    published.clear();
+}
+
+void FakeMqtt::setBrokerUp(bool up) { brokerUp = up; }
+
+void FakeMqtt::setTime(int64_t microseconds) { now = microseconds; }
+
+void FakeMqtt::advanceTime(int64_t microseconds) { now += microseconds; }
+
+void FakeMqtt::sendEvent(esp_mqtt_event_id_t id)
+{
+    esp_mqtt_event_t event{};
+    event.event_id = id;
+    event.client = &client;
+    if (client.handler != nullptr) {
+        client.handler(client.handlerArgs, "MQTT_EVENTS", id, &event);
+    }
+}
+
+const std::vector<std::string> &FakeMqtt::getPublished() { return published; }
+
+int64_t esp_timer_get_time() { return now; }
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *) { return &client; }
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t c, esp_mqtt_event_id_t,
+                                         esp_event_handler_t *handler, void *handler_args)
+{
+    c->handler = handler;
+    c->handlerArgs = handler_args;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t) { return ESP_OK; }
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t) { return ESP_OK; }
+
+esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t) { return ESP_OK; }
+
+esp_err_t esp_mqtt_client_disconnect(esp_mqtt_client_handle_t) { return ESP_OK; }
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t, const char *topic, const char *data, int len, int, int)
+{
+    if (!brokerUp) {
+        return -1;
+    }
+    published.push_back(std::string(topic) + "=" + std::string(data, static_cast<size_t>(len)));
+    return 0;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t, const char *, int) { return 1; }
+
+int esp_mqtt_client_unsubscribe(esp_mqtt_client_handle_t, const char *) { return 1; }
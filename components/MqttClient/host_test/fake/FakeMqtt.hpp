@@ -0,0 +1,23 @@
+#ifndef FAKE_MQTT_HPP
+#define FAKE_MQTT_HPP
+
+#include "mqtt_client.h"
+#include <string>
+#include <vector>
+
+/** @brief Controls the fake esp-mqtt client and timer of the host test
+ *
+ *  There is a single client. Publishing fails while the broker is down,
+ *  otherwise the message is recorded as "topic=data".
+ */
+namespace FakeMqtt {
+void reset();
+void setBrokerUp(bool up);
+void setTime(int64_t microseconds);
+void advanceTime(int64_t microseconds);
+// delivers an event to the handler registered by the client
+void sendEvent(esp_mqtt_event_id_t id);
+const std::vector<std::string> &getPublished();
+} // namespace FakeMqtt
+
+#endif // FAKE_MQTT_HPP
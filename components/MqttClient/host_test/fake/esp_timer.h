@@ -0,0 +1,9 @@
+#ifndef FAKE_ESP_TIMER_H
+#define FAKE_ESP_TIMER_H
+
+#include <stdint.h>
+
+// microseconds, set by FakeMqtt::setTime()
+int64_t esp_timer_get_time();
+
+#endif // FAKE_ESP_TIMER_H
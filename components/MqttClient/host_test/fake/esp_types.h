@@ -0,0 +1,21 @@
+#ifndef FAKE_ESP_TYPES_H
+#define FAKE_ESP_TYPES_H
+
+// the parts of esp_err.h and esp_event.h used by MqttClient
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_INVALID_RESPONSE 0x108
+#define ESP_ERR_NOT_FINISHED 0x10C
+
+typedef const char *esp_event_base_t;
+#define ESP_EVENT_ANY_ID -1
+
+#endif // FAKE_ESP_TYPES_H
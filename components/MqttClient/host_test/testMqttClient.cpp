@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include "FakeMqtt.hpp"
+#include "MqttClient.hpp"
+#include <cstring>
+#include <string>
+#include <vector>
+
+class mqttQueue : public ::testing::Test {
+protected:
+    void SetUp() override { FakeMqtt::reset(); }
+
+    static esp_err_t publish(MqttClient &mqtt, TopicId topic, const char *text)
+    {
+        return mqtt.publish(topic, text, strlen(text));
+    }
+};
+
+TEST_F(mqttQueue, queuedWhileOffline)
+{
+    MqttClient mqtt("n");
+    ASSERT_EQ(mqtt.setOfflineQueue(4, 8), ESP_OK);
+    const TopicId a = mqtt.addTopic("a");
+    const TopicId b = mqtt.addTopic("b");
+    ASSERT_EQ(mqtt.initialize("host", 1883, "", ""), ESP_OK);
+
+    // nothing is sent before the connect event
+    EXPECT_EQ(publish(mqtt, a, "1"), ESP_ERR_NOT_FINISHED);
+    EXPECT_EQ(publish(mqtt, b, "2"), ESP_ERR_NOT_FINISHED);
+    EXPECT_EQ(mqtt.getQueuedCount(), 2u);
+    EXPECT_EQ(mqtt.publish(a, "123456789", 9), ESP_ERR_INVALID_SIZE);
+    EXPECT_TRUE(FakeMqtt::getPublished().empty());
+
+    FakeMqtt::setBrokerUp(true);
+    FakeMqtt::sendEvent(MQTT_EVENT_CONNECTED);
+    EXPECT_TRUE(mqtt.isConnected());
+    EXPECT_EQ(FakeMqtt::getPublished(), (std::vector<std::string>{"n/a=1", "n/b=2"}));
+    EXPECT_EQ(mqtt.getQueuedCount(), 0u);
+
+    // with an empty queue a message goes out at once
+    EXPECT_EQ(publish(mqtt, a, "3"), ESP_OK);
+    EXPECT_EQ(FakeMqtt::getPublished().back(), "n/a=3");
+
+    // a failed publish is queued and retried by the next drain
+    FakeMqtt::setBrokerUp(false);
+    EXPECT_EQ(publish(mqtt, b, "4"), ESP_ERR_NOT_FINISHED);
+    FakeMqtt::setBrokerUp(true);
+    EXPECT_EQ(mqtt.drain(), 1u);
+    EXPECT_EQ(FakeMqtt::getPublished().back(), "n/b=4");
+
+    FakeMqtt::sendEvent(MQTT_EVENT_DISCONNECTED);
+    EXPECT_FALSE(mqtt.isConnected());
+    EXPECT_EQ(publish(mqtt, a, "5"), ESP_ERR_NOT_FINISHED);
+    EXPECT_EQ(mqtt.getDroppedCount(), 0u);
+    EXPECT_EQ(mqtt.getCoalescedCount(), 0u);
+}
+
+TEST_F(mqttQueue, dropOldest)
+{
+    MqttClient mqtt("n");
+    ASSERT_EQ(mqtt.setOfflineQueue(3, 8, MqttClient::QueuePolicy::DropOldest), ESP_OK);
+    const TopicId a = mqtt.addTopic("a");
+    const TopicId b = mqtt.addTopic("b");
+    ASSERT_EQ(mqtt.initialize("host", 1883, "", ""), ESP_OK);
+
+    for (const char *text : {"1", "2", "3", "4", "5"}) {
+        EXPECT_EQ(publish(mqtt, text[0] % 2 ? a : b, text), ESP_ERR_NOT_FINISHED);
+    }
+    EXPECT_EQ(mqtt.getQueuedCount(), 3u);
+    EXPECT_EQ(mqtt.getDroppedCount(), 2u);
+    EXPECT_EQ(mqtt.getCoalescedCount(), 0u);
+
+    FakeMqtt::setBrokerUp(true);
+    FakeMqtt::sendEvent(MQTT_EVENT_CONNECTED);
+    EXPECT_EQ(FakeMqtt::getPublished(), (std::vector<std::string>{"n/a=3", "n/b=4", "n/a=5"}));
+}
+
+TEST_F(mqttQueue, coalesceByTopic)
+{
+    MqttClient mqtt("n");
+    ASSERT_EQ(mqtt.setOfflineQueue(2, 8, MqttClient::QueuePolicy::CoalesceByTopic), ESP_OK);
+    const TopicId a = mqtt.addTopic("a");
+    const TopicId b = mqtt.addTopic("b");
+    const TopicId c = mqtt.addTopic("c");
+    ASSERT_EQ(mqtt.initialize("host", 1883, "", ""), ESP_OK);
+
+    // a full queue replaces the queued message of the same topic in place
+    for (const char *text : {"1", "2", "3", "4", "5"}) {
+        EXPECT_EQ(publish(mqtt, text[0] % 2 ? a : b, text), ESP_ERR_NOT_FINISHED);
+    }
+    EXPECT_EQ(mqtt.getQueuedCount(), 2u);
+    EXPECT_EQ(mqtt.getDroppedCount(), 0u);
+    EXPECT_EQ(mqtt.getCoalescedCount(), 3u);
+
+    // without one of the same topic the oldest is dropped
+    EXPECT_EQ(publish(mqtt, c, "6"), ESP_ERR_NOT_FINISHED);
+    EXPECT_EQ(mqtt.getDroppedCount(), 1u);
+    EXPECT_EQ(mqtt.getCoalescedCount(), 3u);
+
+    FakeMqtt::setBrokerUp(true);
+    FakeMqtt::sendEvent(MQTT_EVENT_CONNECTED);
+    EXPECT_EQ(FakeMqtt::getPublished(), (std::vector<std::string>{"n/b=4", "n/c=6"}));
+}
+
+TEST_F(mqttQueue, drainRate)
+{
+    MqttClient mqtt("n");
+    ASSERT_EQ(mqtt.setOfflineQueue(8, 8), ESP_OK);
+    const TopicId a = mqtt.addTopic("a");
+    ASSERT_EQ(mqtt.initialize("host", 1883, "", ""), ESP_OK);
+    // 2 messages per second, bursts of 3
+    mqtt.setDrainRate(2, 3);
+
+    for (const char *text : {"1", "2", "3", "4", "5", "6", "7", "8"}) {
+        publish(mqtt, a, text);
+    }
+
+    // the bucket filled up while offline, but not beyond the burst
+    FakeMqtt::advanceTime(60000000);
+    FakeMqtt::setBrokerUp(true);
+    FakeMqtt::sendEvent(MQTT_EVENT_CONNECTED);
+    EXPECT_EQ(FakeMqtt::getPublished().size(), 3u);
+    EXPECT_EQ(mqtt.drain(), 0u);
+
+    // one token per 500 ms
+    FakeMqtt::advanceTime(400000);
+    EXPECT_EQ(mqtt.drain(), 0u);
+    FakeMqtt::advanceTime(100000);
+    EXPECT_EQ(mqtt.drain(), 1u);
+    FakeMqtt::advanceTime(1000000);
+    EXPECT_EQ(mqtt.drain(), 2u);
+
+    // a new message waits behind the queued ones
+    EXPECT_EQ(publish(mqtt, a, "9"), ESP_ERR_NOT_FINISHED);
+    EXPECT_EQ(mqtt.getQueuedCount(), 3u);
+    FakeMqtt::advanceTime(10000000);
+    EXPECT_EQ(mqtt.drain(), 3u);
+    EXPECT_EQ(FakeMqtt::getPublished(),
+              (std::vector<std::string>{"n/a=1", "n/a=2", "n/a=3", "n/a=4", "n/a=5", "n/a=6", "n/a=7", "n/a=8", "n/a=9"}));
+}
+
+TEST_F(mqttQueue, withoutQueue)
+{
+    MqttClient mqtt("n");
+    const TopicId a = mqtt.addTopic("a");
+    ASSERT_EQ(mqtt.initialize("host", 1883, "", ""), ESP_OK);
+
+    EXPECT_EQ(publish(mqtt, a, "1"), ESP_FAIL);
+    FakeMqtt::setBrokerUp(true);
+    EXPECT_EQ(mqtt.publish(a, "1", 1, 1), ESP_OK);
+    EXPECT_EQ(mqtt.getQueuedCount(), 0u);
+}
+
+TEST_F(mqttQueue, topicsFixedByInitialize)
+{
+    MqttClient mqtt("n");
+    const TopicId a = mqtt.addTopic("a");
+    EXPECT_EQ(mqtt.addTopic("a"), a);
+    ASSERT_EQ(mqtt.initialize("host", 1883, "", ""), ESP_OK);
+
+    EXPECT_EQ(mqtt.addTopic("b"), MqttClient::INVALID_TOPIC);
+    EXPECT_STREQ(mqtt.getTopic(a), "n/a");
+    EXPECT_EQ(mqtt.getTopic(a + 1), nullptr);
+}
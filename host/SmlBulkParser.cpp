@@ -0,0 +1,190 @@
+#include "SmlBulkParser.hpp"
+#include "SmlFrameSync.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
+#include <utility>
+
+namespace
+{
+// collects the list entries of one frame
+struct FrameCollector : SmlVisitor
+{
+  SmlBulkFrame *frame{nullptr};
+
+  void onListStart(const SmlGetListRes &head)
+  {
+    frame->sensorTime = head.actSensorTime;
+  }
+  void onListEntry(const SmlListEntryView &entry)
+  {
+    frame->entries.push_back(entry);
+  }
+};
+} // namespace
+
+bool SmlBulkParser::WorkQueue::pop(size_t &chunk)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (chunks.empty())
+  {
+    return false;
+  }
+  chunk = chunks.front();
+  chunks.pop_front();
+  return true;
+}
+
+bool SmlBulkParser::WorkQueue::steal(size_t &chunk)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (chunks.empty())
+  {
+    return false;
+  }
+  chunk = chunks.back();
+  chunks.pop_back();
+  return true;
+}
+
+SmlBulkParser::SmlBulkParser(unsigned t_thread_count, size_t t_chunk_size)
+    : threadCount{t_thread_count}, chunkSize{t_chunk_size}
+{
+  if (threadCount == 0)
+  {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  chunkSize = std::max<size_t>(chunkSize, SML_START_SEQUENCE_LENGTH);
+}
+
+void SmlBulkParser::setObisFilter(const SmlObisFilter filter)
+{
+  obisFilter = filter;
+}
+
+std::vector<SmlBulkParser::Chunk>
+SmlBulkParser::split(const unsigned char *data, const size_t size) const
+{
+  std::vector<Chunk> chunks;
+  chunks.reserve(size / chunkSize + 1);
+
+  size_t begin = 0;
+  while (begin < size)
+  {
+    size_t end = begin + chunkSize;
+    if (end >= size)
+    {
+      end = size;
+    }
+    else
+    {
+      // a frame belongs to the chunk holding its start sequence
+      const size_t next = sml_find_start_sequence(data, size, end);
+      end = next == SML_NPOS ? size : next;
+    }
+    chunks.push_back(Chunk{begin, end});
+    begin = end;
+  }
+  return chunks;
+}
+
+void SmlBulkParser::parseChunk(SmlParser &parser, const unsigned char *data,
+                               const Chunk &chunk,
+                               std::vector<SmlBulkFrame> &frames) const
+{
+  parser.setBuffer(data + chunk.begin, chunk.end - chunk.begin);
+
+  FrameCollector collector;
+  for (;;)
+  {
+    SmlBulkFrame frame{};
+    collector.frame = &frame;
+    frame.result = parser.parseNext(collector);
+    if (frame.result == SML_END_OF_DATA)
+    {
+      break;
+    }
+    if (frame.result != SML_OK)
+    {
+      frame.entries.clear();
+    }
+    frame.offset = chunk.begin + parser.getFrameOffset();
+    frames.push_back(std::move(frame));
+  }
+}
+
+size_t SmlBulkParser::parse(const unsigned char *data, const size_t size,
+                            const SmlBulkFrameHandler &handler)
+{
+  if (data == nullptr || size == 0)
+  {
+    return 0;
+  }
+
+  const std::vector<Chunk> chunks = split(data, size);
+  const unsigned workers = static_cast<unsigned>(
+      std::min<size_t>(threadCount, chunks.size()));
+
+  std::vector<WorkQueue> queues(workers);
+  for (size_t i = 0; i < chunks.size(); ++i)
+  {
+    queues[i % workers].chunks.push_back(i);
+  }
+
+  std::vector<ChunkResult> results(chunks.size());
+  std::mutex resultMutex;
+  std::condition_variable resultReady;
+
+  auto work = [&](const std::stop_token stop, const unsigned self) {
+    SmlParser parser(nullptr, 0);
+    parser.setObisFilter(obisFilter);
+
+    size_t chunk;
+    while (!stop.stop_requested())
+    {
+      bool found = queues[self].pop(chunk);
+      for (unsigned i = 1; !found && i < workers; ++i)
+      {
+        found = queues[(self + i) % workers].steal(chunk);
+      }
+      // no chunk is queued after the start, so empty queues mean done
+      if (!found)
+      {
+        return;
+      }
+
+      parseChunk(parser, data, chunks[chunk], results[chunk].frames);
+      {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        results[chunk].done = true;
+      }
+      resultReady.notify_one();
+    }
+  };
+
+  // a jthread asks its worker to stop and joins it when destroyed, also
+  // when handler throws
+  std::vector<std::jthread> threads;
+  threads.reserve(workers);
+  for (unsigned i = 0; i < workers; ++i)
+  {
+    threads.emplace_back(work, i);
+  }
+
+  // merge in input order while the workers go on
+  size_t frameCount = 0;
+  for (ChunkResult &result : results)
+  {
+    {
+      std::unique_lock<std::mutex> lock(resultMutex);
+      resultReady.wait(lock, [&result] { return result.done; });
+    }
+    for (const SmlBulkFrame &frame : result.frames)
+    {
+      handler(frame);
+    }
+    frameCount += result.frames.size();
+    std::vector<SmlBulkFrame>().swap(result.frames);
+  }
+  return frameCount;
+}
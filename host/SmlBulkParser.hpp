@@ -0,0 +1,98 @@
+#ifndef SML_BULK_PARSER_HPP
+#define SML_BULK_PARSER_HPP
+
+#include "SmlObisSet.hpp"
+#include "SmlParser.hpp"
+#include "SmlTypes.hpp"
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <vector>
+
+/** @brief One frame found by SmlBulkParser */
+struct SmlBulkFrame {
+  size_t offset;      // position of the start sequence in the input
+  sml_error_t result; // see SmlParser::parseNext()
+  SmlTime sensorTime; // actSensorTime of the GetList.Res
+  std::vector<SmlListEntry> entries; // empty unless result is SML_OK
+};
+
+/** @brief Called for every frame, in input order, on the calling thread */
+using SmlBulkFrameHandler = std::function<void(const SmlBulkFrame &frame)>;
+
+/** @brief Parses large captures (hours or months of frames) on all cores
+ *
+ *  The input is cut into chunks of roughly getChunkSize() bytes. Every cut
+ *  is moved forward to the next start sequence, so a frame always lies in
+ *  the chunk holding its start sequence, including frames that straddle the
+ *  nominal cut. The chunks are parsed by a pool of worker threads, each with
+ *  its own SmlParser, and the frames are handed to the caller in input
+ *  order while the workers go on.
+ *
+ *  Chunks are dealt round robin to per-worker queues. A worker takes the
+ *  oldest chunk of its own queue, which keeps the in-order merge moving, and
+ *  steals the newest chunk of another queue when its own one ran dry.
+ *
+ *  The entries are views into the input, which has to outlive the frames.
+ *  SmlLogger is shared by all workers; keep its level at Error or above.
+ */
+class SmlBulkParser {
+private:
+  static const size_t DEFAULT_CHUNK_SIZE = 1 << 20;
+
+  struct Chunk {
+    size_t begin;
+    size_t end;
+  };
+
+  struct ChunkResult {
+    std::vector<SmlBulkFrame> frames;
+    bool done{false};
+  };
+
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> chunks;
+
+    bool pop(size_t &chunk);
+    bool steal(size_t &chunk);
+  };
+
+  unsigned threadCount;
+  size_t chunkSize;
+  SmlObisFilter obisFilter;
+
+  std::vector<Chunk> split(const unsigned char *data, const size_t size) const;
+  void parseChunk(SmlParser &parser, const unsigned char *data,
+                  const Chunk &chunk, std::vector<SmlBulkFrame> &frames) const;
+
+public:
+  /** @brief Creates a bulk parser
+   *  @param t_thread_count Number of worker threads, 0 for one per core
+   *  @param t_chunk_size Nominal number of input bytes per work item
+   */
+  explicit SmlBulkParser(unsigned t_thread_count = 0,
+                         size_t t_chunk_size = DEFAULT_CHUNK_SIZE);
+
+  /** @brief Restricts the GetList.Res entries of every frame
+   *  @param filter see SmlParser::setObisFilter()
+   */
+  void setObisFilter(const SmlObisFilter filter);
+
+  unsigned getThreadCount() const { return threadCount; }
+  size_t getChunkSize() const { return chunkSize; }
+
+  /** @brief Parses every frame of the input
+   *  @param data The capture, e.g. a mapped file
+   *  @param size Size of the capture
+   *  @param handler Receives the frames in input order. If it throws, the
+   *         workers stop after their current chunk and are joined before
+   *         the exception leaves parse().
+   *  @return number of frames passed to handler, broken ones included
+   */
+  size_t parse(const unsigned char *data, const size_t size,
+               const SmlBulkFrameHandler &handler);
+};
+
+#endif // SML_BULK_PARSER_HPP
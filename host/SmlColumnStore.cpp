@@ -0,0 +1,198 @@
+#include "SmlColumnStore.hpp"
+#include <cstring>
+
+SmlColumnWriter::SmlColumnWriter(FILE *t_out) : out{t_out} {}
+
+SmlColumnWriter::~SmlColumnWriter() { flush(); }
+
+void SmlColumnWriter::write(const void *data, const size_t length) {
+  if (!failed && fwrite(data, 1, length, out) != length) {
+    failed = true;
+  }
+}
+
+void SmlColumnWriter::append(const uint32_t time, const SmlListEntry &entry) {
+  const ObisCode obis = entry.obis();
+  if (!obis.isValid() || (entry.type() != SmlValueType::Unsigned &&
+                          entry.type() != SmlValueType::Integer)) {
+    return;
+  }
+
+  auto found = columnIndex.find(obis.packed);
+  if (found == columnIndex.end()) {
+    found = columnIndex.emplace(obis.packed, columns.size()).first;
+    Column column;
+    column.obis = obis;
+    column.unit = entry.unit();
+    column.scaler = entry.scaler();
+    columns.push_back(std::move(column));
+  }
+
+  Column &column = columns[found->second];
+  if (column.unit != entry.unit() || column.scaler != entry.scaler()) {
+    // a block has a single unit and scaler
+    writeBlock(column);
+    column.unit = entry.unit();
+    column.scaler = entry.scaler();
+  }
+
+  // iValue() holds the bits of either type, unsigned values above
+  // INT64_MAX wrap and the reader gets the same bits back
+  const int64_t value = static_cast<int64_t>(entry.iValue());
+  column.samples.push_back(SmlColumnSample{time, value, entry.status()});
+  if (column.samples.size() >= BLOCK_SAMPLES) {
+    writeBlock(column);
+  }
+}
+
+void SmlColumnWriter::append(const SmlTime &sensorTime,
+                             std::span<const SmlListEntry> entries) {
+  for (const SmlListEntry &entry : entries) {
+    const uint32_t valTime = entry.valTime().timeValue;
+    append(valTime != 0 ? valTime : sensorTime.timeValue, entry);
+  }
+}
+
+void SmlColumnWriter::writeBlock(Column &column) {
+  if (column.samples.empty()) {
+    return;
+  }
+
+  times.clear();
+  values.clear();
+  status.clear();
+
+  SmlDeltaOfDelta time;
+  SmlDeltaOfDelta value;
+  uint64_t previousStatus = 0;
+  uint8_t varint[SML_VARINT_MAX_LENGTH];
+  for (const SmlColumnSample &sample : column.samples) {
+    size_t length =
+        sml_varint_encode(sml_zigzag_encode(time.encode(sample.time)), varint);
+    times.insert(times.end(), varint, varint + length);
+
+    length = sml_varint_encode(sml_zigzag_encode(value.encode(sample.value)),
+                               varint);
+    values.insert(values.end(), varint, varint + length);
+
+    length = sml_varint_encode(sample.status ^ previousStatus, varint);
+    status.insert(status.end(), varint, varint + length);
+    previousStatus = sample.status;
+  }
+
+  if (!headerWritten) {
+    write(SML_COLUMN_MAGIC, sizeof(SML_COLUMN_MAGIC));
+    write(&SML_COLUMN_VERSION, 1);
+    headerWritten = true;
+  }
+
+  uint8_t header[6 + 2 + 4 * SML_VARINT_MAX_LENGTH];
+  size_t length = 0;
+  for (size_t i = 0; i < 6; ++i) {
+    header[length++] = column.obis.byte(i);
+  }
+  header[length++] = column.unit;
+  header[length++] = static_cast<uint8_t>(column.scaler);
+  length += sml_varint_encode(column.samples.size(), &header[length]);
+  length += sml_varint_encode(times.size(), &header[length]);
+  length += sml_varint_encode(values.size(), &header[length]);
+  length += sml_varint_encode(status.size(), &header[length]);
+
+  write(header, length);
+  write(times.data(), times.size());
+  write(values.data(), values.size());
+  write(status.data(), status.size());
+  column.samples.clear();
+}
+
+bool SmlColumnWriter::flush() {
+  for (Column &column : columns) {
+    writeBlock(column);
+  }
+  if (!failed && fflush(out) != 0) {
+    failed = true;
+  }
+  return !failed;
+}
+
+SmlColumnReader::SmlColumnReader(const unsigned char *t_data,
+                                 const size_t t_size)
+    : data{t_data}, size{t_size} {}
+
+bool SmlColumnReader::isValid() const {
+  return data != nullptr && size >= begin() &&
+         memcmp(data, SML_COLUMN_MAGIC, sizeof(SML_COLUMN_MAGIC)) == 0 &&
+         data[sizeof(SML_COLUMN_MAGIC)] == SML_COLUMN_VERSION;
+}
+
+bool SmlColumnReader::readBlockHeader(size_t &position,
+                                      SmlColumnBlock &block) const {
+  if (position + 8 > size) {
+    return false;
+  }
+  block.obis = ObisCode::fromBytes(&data[position], 6);
+  block.unit = data[position + 6];
+  block.scaler = static_cast<int8_t>(data[position + 7]);
+  position += 8;
+
+  uint64_t count;
+  uint64_t lengths[3];
+  if (!sml_varint_decode(data, size, position, count)) {
+    return false;
+  }
+  for (uint64_t &length : lengths) {
+    if (!sml_varint_decode(data, size, position, length)) {
+      return false;
+    }
+  }
+  size_t remaining = size - position;
+  for (const uint64_t length : lengths) {
+    if (length > remaining) {
+      return false;
+    }
+    remaining -= length;
+  }
+
+  block.count = static_cast<uint32_t>(count);
+  block.times = SmlBytesView{&data[position], lengths[0]};
+  block.values = SmlBytesView{block.times.data + lengths[0], lengths[1]};
+  block.status = SmlBytesView{block.values.data + lengths[1], lengths[2]};
+  return true;
+}
+
+bool SmlColumnReader::nextBlock(size_t &position,
+                                SmlColumnBlock &block) const {
+  if (!isValid()) {
+    return false;
+  }
+  size_t next = position;
+  if (!readBlockHeader(next, block)) {
+    return false;
+  }
+  position = static_cast<size_t>(block.status.data + block.status.length -
+                                 data);
+  return true;
+}
+
+std::vector<SmlColumnInfo> SmlColumnReader::getColumns() const {
+  std::vector<SmlColumnInfo> columns;
+  std::unordered_map<uint64_t, size_t> index;
+
+  size_t position = begin();
+  SmlColumnBlock block;
+  while (nextBlock(position, block)) {
+    // the OBIS code takes the low six bytes
+    const uint8_t scaler = static_cast<uint8_t>(block.scaler);
+    const uint64_t key = block.obis.packed | uint64_t{block.unit} << 48 |
+                         uint64_t{scaler} << 56;
+    auto found = index.find(key);
+    if (found == index.end()) {
+      index.emplace(key, columns.size());
+      columns.push_back(
+          SmlColumnInfo{block.obis, block.unit, block.scaler, block.count});
+    } else {
+      columns[found->second].count += block.count;
+    }
+  }
+  return columns;
+}
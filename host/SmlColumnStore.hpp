@@ -0,0 +1,207 @@
+#ifndef SML_COLUMN_STORE_HPP
+#define SML_COLUMN_STORE_HPP
+
+#include "SmlTypes.hpp"
+#include "SmlVarint.hpp"
+#include <span>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unordered_map>
+#include <vector>
+
+/*  Columnar time series file, one column per OBIS code:
+ *
+ *  file   := "SMLC" version:u8 block*
+ *  block  := obis:6 unit:u8 scaler:i8 count:varint
+ *            timeLength:varint valueLength:varint statusLength:varint
+ *            times[timeLength] values[valueLength] status[statusLength]
+ *  times  := count zig-zag varints, delta-of-delta of the time stamps
+ *  values := count zig-zag varints, delta-of-delta of the unscaled values
+ *  status := count varints, each status word XOR the previous one
+ *
+ *  A block holds up to SmlColumnWriter::BLOCK_SAMPLES samples of a single
+ *  column and decodes on its own. Readers skip the blocks of other columns,
+ *  and the sections of a block they do not need, by their lengths.
+ */
+
+/** @brief Magic bytes at the start of a column file */
+const unsigned char SML_COLUMN_MAGIC[4] = {'S', 'M', 'L', 'C'};
+const uint8_t SML_COLUMN_VERSION = 1;
+
+/** @brief One sample of a column */
+struct SmlColumnSample {
+  uint32_t time;   // actSensorTime, or valTime if the entry has one
+  int64_t value;   // unscaled, multiply by 10^scaler
+  uint64_t status; // status word of the entry, 0 if it had none
+};
+
+/** @brief Header of a block as found by SmlColumnReader::nextBlock() */
+struct SmlColumnBlock {
+  ObisCode obis;
+  uint8_t unit{0};
+  int8_t scaler{0};
+  uint32_t count{0};
+  SmlBytesView times;
+  SmlBytesView values;
+  SmlBytesView status;
+};
+
+/** @brief Summary of the blocks of one column sharing unit and scaler */
+struct SmlColumnInfo {
+  ObisCode obis;
+  uint8_t unit;
+  int8_t scaler;
+  uint64_t count;
+};
+
+/** @brief Writes numeric list entries to a column file
+ *
+ *  Samples are buffered per column and written as a block once
+ *  BLOCK_SAMPLES are collected, when unit or scaler of a column change and
+ *  on flush(). Octet string entries are skipped.
+ */
+class SmlColumnWriter {
+public:
+  static const size_t BLOCK_SAMPLES = 4096;
+
+private:
+  struct Column {
+    ObisCode obis;
+    uint8_t unit{0};
+    int8_t scaler{0};
+    std::vector<SmlColumnSample> samples;
+  };
+
+  FILE *out;
+  bool headerWritten{false};
+  bool failed{false};
+  std::vector<Column> columns;
+  std::unordered_map<uint64_t, size_t> columnIndex;
+  std::vector<uint8_t> times;
+  std::vector<uint8_t> values;
+  std::vector<uint8_t> status;
+
+  void writeBlock(Column &column);
+  void write(const void *data, const size_t length);
+
+public:
+  /** @brief Creates a writer
+   *  @param t_out Open file or pipe, has to outlive the writer
+   */
+  explicit SmlColumnWriter(FILE *t_out);
+  ~SmlColumnWriter();
+
+  SmlColumnWriter(const SmlColumnWriter &) = delete;
+  SmlColumnWriter &operator=(const SmlColumnWriter &) = delete;
+
+  /** @brief Appends one list entry
+   *  @param time Time stamp of the sample
+   *  @param entry The entry, skipped if it holds no number or no OBIS code
+   */
+  void append(const uint32_t time, const SmlListEntry &entry);
+
+  /** @brief Appends the entries of a GetList.Res
+   *  @param sensorTime actSensorTime of the list, used for every entry
+   *         without a valTime of its own
+   *  @param entries The valList
+   */
+  void append(const SmlTime &sensorTime,
+              std::span<const SmlListEntry> entries);
+
+  /** @brief Writes all buffered samples
+   *  @return false if a write failed, now or earlier
+   */
+  bool flush();
+};
+
+/** @brief Reads a column file, e.g. mapped by SmlFileSource */
+class SmlColumnReader {
+private:
+  const unsigned char *data;
+  size_t size;
+
+  bool readBlockHeader(size_t &position, SmlColumnBlock &block) const;
+
+public:
+  SmlColumnReader(const unsigned char *t_data, const size_t t_size);
+
+  /** @brief Checks magic and version
+   *  @return true if the data is a column file this reader understands
+   */
+  bool isValid() const;
+
+  /** @brief Returns the offset of the first block */
+  size_t begin() const { return sizeof(SML_COLUMN_MAGIC) + 1; }
+
+  /** @brief Reads a block header and skips the block
+   *  @param position Offset of the block, advanced to the next one
+   *  @param block Receives the header and views of the sections
+   *  @return false at the end of the file or on a truncated block
+   */
+  bool nextBlock(size_t &position, SmlColumnBlock &block) const;
+
+  /** @brief Lists the columns with their number of samples
+   *
+   *  A column whose unit or scaler changes is listed once per unit and
+   *  scaler, in the order they first appear. Only the block headers are
+   *  read.
+   */
+  std::vector<SmlColumnInfo> getColumns() const;
+
+  /** @brief Decodes the samples of one column
+   *
+   *  Blocks of other columns are skipped without decoding.
+   *  @param obis The column
+   *  @param visitor Callable as visitor(const SmlColumnBlock &,
+   *         const SmlColumnSample &)
+   *  @return number of samples passed to visitor
+   */
+  template <typename Visitor>
+  size_t scanColumn(const ObisCode obis, Visitor &&visitor) const;
+};
+
+template <typename Visitor>
+size_t SmlColumnReader::scanColumn(const ObisCode obis,
+                                   Visitor &&visitor) const {
+  size_t samples = 0;
+  size_t position = begin();
+  SmlColumnBlock block;
+  while (nextBlock(position, block)) {
+    if (block.obis != obis) {
+      continue;
+    }
+
+    SmlDeltaOfDelta time;
+    SmlDeltaOfDelta value;
+    uint64_t previousStatus = 0;
+    size_t t = 0;
+    size_t v = 0;
+    size_t s = 0;
+    for (uint32_t i = 0; i < block.count; ++i) {
+      uint64_t rawTime;
+      uint64_t rawValue;
+      uint64_t rawStatus;
+      if (!sml_varint_decode(block.times.data, block.times.length, t,
+                             rawTime) ||
+          !sml_varint_decode(block.values.data, block.values.length, v,
+                             rawValue) ||
+          !sml_varint_decode(block.status.data, block.status.length, s,
+                             rawStatus)) {
+        return samples;
+      }
+
+      SmlColumnSample sample;
+      sample.time =
+          static_cast<uint32_t>(time.decode(sml_zigzag_decode(rawTime)));
+      sample.value = value.decode(sml_zigzag_decode(rawValue));
+      previousStatus ^= rawStatus;
+      sample.status = previousStatus;
+      visitor(block, sample);
+      ++samples;
+    }
+  }
+  return samples;
+}
+
+#endif // SML_COLUMN_STORE_HPP
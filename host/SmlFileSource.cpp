@@ -0,0 +1,68 @@
+#include "SmlFileSource.hpp"
+#include "SmlLogger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SmlFileSource::~SmlFileSource() { close(); }
+
+sml_error_t SmlFileSource::open(const char *path)
+{
+  close();
+  if (path == nullptr)
+  {
+    return SML_ERROR_NULLPTR;
+  }
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    SmlLogger::Error("Unable to open %s: %s", path, strerror(errno));
+    return SML_NOK;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0)
+  {
+    SmlLogger::Error("Unable to stat %s: %s", path, strerror(errno));
+    ::close(fd);
+    return SML_NOK;
+  }
+  if (info.st_size == 0)
+  {
+    ::close(fd);
+    return SML_ERROR_ZEROLENGTH;
+  }
+
+  const size_t length = static_cast<size_t>(info.st_size);
+  void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps its own reference to the file
+  ::close(fd);
+  if (address == MAP_FAILED)
+  {
+    SmlLogger::Error("Unable to map %s: %s", path, strerror(errno));
+    return SML_NOK;
+  }
+
+  if (madvise(address, length, MADV_SEQUENTIAL) != 0)
+  {
+    SmlLogger::Warning("madvise failed for %s: %s", path, strerror(errno));
+  }
+
+  mapping = static_cast<const unsigned char *>(address);
+  mapping_size = length;
+  return SML_OK;
+}
+
+void SmlFileSource::close()
+{
+  if (mapping != nullptr)
+  {
+    munmap(const_cast<unsigned char *>(mapping), mapping_size);
+  }
+  mapping = nullptr;
+  mapping_size = 0;
+}
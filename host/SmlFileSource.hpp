@@ -0,0 +1,44 @@
+#ifndef SML_FILE_SOURCE_HPP
+#define SML_FILE_SOURCE_HPP
+
+#include "SmlTypes.hpp"
+#include <stddef.h>
+
+/** @brief Read-only memory mapping of a capture file
+ *
+ *  The file is mapped instead of read, so captures of many gigabytes are
+ *  parsed in place and only the pages currently walked by the parser are
+ *  resident. The kernel is told that the mapping is read sequentially, so
+ *  it reads ahead aggressively and drops pages behind the parser early.
+ */
+class SmlFileSource
+{
+private:
+  const unsigned char *mapping{nullptr};
+  size_t mapping_size{0};
+
+public:
+  SmlFileSource() = default;
+  ~SmlFileSource();
+
+  SmlFileSource(const SmlFileSource &) = delete;
+  SmlFileSource &operator=(const SmlFileSource &) = delete;
+
+  /** @brief Maps a file, a previously mapped file is unmapped first
+   *  @param path Path of the capture file
+   *  @return SML_OK on success
+   *  @return SML_ERROR_NULLPTR if path is NULL
+   *  @return SML_ERROR_ZEROLENGTH if the file is empty
+   *  @return SML_NOK if the file cannot be opened or mapped
+   */
+  sml_error_t open(const char *path);
+
+  /** @brief Unmaps the file, views into it become invalid */
+  void close();
+
+  bool isOpen() const { return mapping != nullptr; }
+  const unsigned char *data() const { return mapping; }
+  size_t size() const { return mapping_size; }
+};
+
+#endif // SML_FILE_SOURCE_HPP
@@ -0,0 +1,243 @@
+// smldump: decodes the GetList.Res entries of a SML capture file to CSV,
+// JSON or a column file (see SmlColumnStore.hpp) on stdout. Library
+// diagnostics go to stderr.
+//
+//   smldump [-f csv|json|column] [-j threads] [-e obis,...] capture.bin
+
+#include "SmlBulkParser.hpp"
+#include "SmlColumnStore.hpp"
+#include "SmlFileSource.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+SmlLogLevel SmlLogger::logLevel{SmlLogLevel::Error};
+
+enum class OutputFormat { Csv, Json, Column };
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [-f csv|json|column] [-j threads] [-e obis,...] capture\n"
+          "  -f  output format, csv by default\n"
+          "  -j  worker threads, one per core by default\n"
+          "  -e  only these OBIS codes, e.g. 1-0:1.8.0*255,1-0:16.7.0*255\n",
+          name);
+}
+
+static bool parseObisList(const char *text, std::vector<ObisCode> &codes)
+{
+  while (*text != '\0')
+  {
+    const char *end = strchr(text, ',');
+    const size_t length = end != nullptr ? static_cast<size_t>(end - text)
+                                         : strlen(text);
+    const ObisCode code = ObisCode::parse(text, length);
+    if (!code.isValid())
+    {
+      fprintf(stderr, "invalid OBIS code: %.*s\n", static_cast<int>(length),
+              text);
+      return false;
+    }
+    codes.push_back(code);
+    text += length;
+    if (*text == ',')
+    {
+      ++text;
+    }
+  }
+
+  // SmlObisFilter expects the codes sorted
+  std::sort(codes.begin(), codes.end(), [](const ObisCode a, const ObisCode b) {
+    return a.packed < b.packed;
+  });
+  return true;
+}
+
+static void printHex(FILE *out, const SmlBytesView &bytes)
+{
+  for (size_t i = 0; i < bytes.size(); ++i)
+  {
+    fprintf(out, "%02x", bytes[i]);
+  }
+}
+
+static void printValue(FILE *out, const SmlListEntry &entry)
+{
+  if (entry.isString())
+  {
+    printHex(out, entry.sValue());
+  }
+  else
+  {
+    fprintf(out, "%.15g", entry.value());
+  }
+}
+
+static void printCsv(FILE *out, const SmlBulkFrame &frame)
+{
+  if (frame.result != SML_OK)
+  {
+    fprintf(out, "%zu,%d,,,,\n", frame.offset, frame.result);
+    return;
+  }
+
+  for (const SmlListEntry &entry : frame.entries)
+  {
+    fprintf(out, "%zu,%d,%s,%u,%d,", frame.offset, frame.result,
+            entry.obis().toString().c_str(), entry.unit(), entry.scaler());
+    printValue(out, entry);
+    fputc('\n', out);
+  }
+}
+
+static void printJson(FILE *out, const SmlBulkFrame &frame, const bool first)
+{
+  fprintf(out, "%s{\"offset\":%zu,\"result\":%d,\"entries\":[",
+          first ? "" : ",\n", frame.offset, frame.result);
+
+  for (size_t i = 0; i < frame.entries.size(); ++i)
+  {
+    const SmlListEntry &entry = frame.entries[i];
+    fprintf(out, "%s{\"obis\":\"%s\",\"unit\":%u,\"scaler\":%d,",
+            i == 0 ? "" : ",", entry.obis().toString().c_str(), entry.unit(),
+            entry.scaler());
+    if (entry.isString())
+    {
+      fputs("\"bytes\":\"", out);
+      printHex(out, entry.sValue());
+      fputs("\"}", out);
+    }
+    else
+    {
+      fputs("\"value\":", out);
+      printValue(out, entry);
+      fputc('}', out);
+    }
+  }
+  fputs("]}", out);
+}
+
+int main(int argc, char **argv)
+{
+  OutputFormat format = OutputFormat::Csv;
+  unsigned threads = 0;
+  std::vector<ObisCode> wanted;
+
+  int option;
+  while ((option = getopt(argc, argv, "f:j:e:h")) != -1)
+  {
+    switch (option)
+    {
+    case 'f':
+      if (strcmp(optarg, "csv") == 0)
+      {
+        format = OutputFormat::Csv;
+      }
+      else if (strcmp(optarg, "json") == 0)
+      {
+        format = OutputFormat::Json;
+      }
+      else if (strcmp(optarg, "column") == 0)
+      {
+        format = OutputFormat::Column;
+      }
+      else
+      {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'j':
+      threads = static_cast<unsigned>(strtoul(optarg, nullptr, 10));
+      break;
+    case 'e':
+      if (!parseObisList(optarg, wanted))
+      {
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (optind != argc - 1)
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // SmlLogger prints to stdout: keep the real stdout for the data and send
+  // everything else to stderr
+  fflush(stdout);
+  FILE *out = fdopen(dup(STDOUT_FILENO), "w");
+  if (out == nullptr || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+  {
+    perror("smldump");
+    return EXIT_FAILURE;
+  }
+
+  SmlFileSource source;
+  const sml_error_t result = source.open(argv[optind]);
+  if (result != SML_OK)
+  {
+    fprintf(stderr, "unable to read %s (error %d)\n", argv[optind], result);
+    return EXIT_FAILURE;
+  }
+
+  SmlBulkParser bulk(threads);
+  if (!wanted.empty())
+  {
+    bulk.setObisFilter(SmlObisFilter(wanted.data(), wanted.size()));
+  }
+
+  bool first = true;
+  if (format == OutputFormat::Csv)
+  {
+    fputs("offset,result,obis,unit,scaler,value\n", out);
+  }
+  else if (format == OutputFormat::Json)
+  {
+    fputs("[\n", out);
+  }
+
+  SmlColumnWriter columns(out);
+  const size_t frames =
+      bulk.parse(source.data(), source.size(), [&](const SmlBulkFrame &frame) {
+        switch (format)
+        {
+        case OutputFormat::Csv:
+          printCsv(out, frame);
+          break;
+        case OutputFormat::Json:
+          printJson(out, frame, first);
+          first = false;
+          break;
+        case OutputFormat::Column:
+          columns.append(frame.sensorTime, frame.entries);
+          break;
+        }
+      });
+
+  if (format == OutputFormat::Json)
+  {
+    fputs("\n]\n", out);
+  }
+  const bool written = columns.flush();
+  fclose(out);
+
+  fflush(stdout);
+  fprintf(stderr, "%zu frames\n", frames);
+  if (!written)
+  {
+    fprintf(stderr, "write error\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,42 @@
+#ifndef SML_ARENA_HPP
+#define SML_ARENA_HPP
+
+#include <memory_resource>
+#include <stddef.h>
+
+/** @brief Fixed-size arena for the results of one SML frame
+ *
+ *  Allocations are bumped out of the storage given to the constructor and
+ *  are only released all at once by reset(), which the parser calls at the
+ *  start of every frame. If a frame needs more than the storage holds, the
+ *  rest comes from the upstream resource (the heap by default) until the
+ *  next reset.
+ */
+class SmlArena {
+private:
+  std::pmr::monotonic_buffer_resource resource;
+
+public:
+  /** @brief Creates an arena in caller-provided storage
+   *  @param storage Buffer the results are allocated from
+   *  @param size Size of the buffer in bytes
+   *  @param upstream Resource used when the storage is exhausted
+   */
+  SmlArena(void *storage, size_t size,
+           std::pmr::memory_resource *upstream =
+               std::pmr::get_default_resource())
+      : resource{storage, size, upstream} {}
+
+  SmlArena(const SmlArena &) = delete;
+  SmlArena &operator=(const SmlArena &) = delete;
+
+  /** @brief Gives the memory resource to allocate from
+   *  @return the arena as std::pmr::memory_resource
+   */
+  std::pmr::memory_resource *getResource() { return &resource; }
+
+  /** @brief Releases all allocations, nothing may refer to them anymore */
+  void reset() { resource.release(); }
+};
+
+#endif // SML_ARENA_HPP
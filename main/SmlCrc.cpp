@@ -1,4 +1,5 @@
 #include "SmlCrc.hpp"
+#include <array>
 
 // init value for CRC16/X.25
 static const uint16_t CRC_INIT_VAL = 0xFFFFu;
@@ -49,4 +50,101 @@ uint16_t sml_crc16(unsigned char *cp, int len) {
   crc = ((crc & 0x00FFu) << 8u) | ((crc & 0xFF00u) >> 8u);
 
   return crc;
-}
\ No newline at end of file
+}
+
+// crcslices[k][i] is the crc contribution of byte i followed by k zero bytes
+static constexpr std::array<std::array<uint16_t, 256>, SML_CRC16_SLICES>
+makeCrcSlices() {
+  std::array<std::array<uint16_t, 256>, SML_CRC16_SLICES> slices{};
+  for (int i = 0; i < 256; ++i) {
+    slices[0][i] = crctab[i];
+  }
+  for (int k = 1; k < SML_CRC16_SLICES; ++k) {
+    for (int i = 0; i < 256; ++i) {
+      const uint16_t prev = slices[k - 1][i];
+      slices[k][i] = (prev >> 8u) ^ crctab[prev & 0xFFu];
+    }
+  }
+  return slices;
+}
+
+static constexpr std::array<std::array<uint16_t, 256>, SML_CRC16_SLICES>
+    crcslices = makeCrcSlices();
+
+static_assert(SML_CRC16_SLICES == 4 || SML_CRC16_SLICES == 8,
+              "SML_CRC16_SLICES must be 4 or 8");
+
+SmlCrc16::SmlCrc16() : crc{CRC_INIT_VAL} {}
+
+void SmlCrc16::init() { crc = CRC_INIT_VAL; }
+
+void SmlCrc16::update(const unsigned char byte) {
+  crc = (crc >> 8u) ^ (crctab[(crc ^ byte) & 0xFFu]);
+}
+
+void SmlCrc16::update(const unsigned char *data, size_t len) {
+  uint16_t c = crc;
+
+  while (len >= SML_CRC16_SLICES) {
+    c ^= static_cast<uint16_t>(data[0] | (data[1] << 8u));
+#if SML_CRC16_SLICES == 8
+    c = crcslices[7][c & 0xFFu] ^ crcslices[6][c >> 8u] ^
+        crcslices[5][data[2]] ^ crcslices[4][data[3]] ^
+        crcslices[3][data[4]] ^ crcslices[2][data[5]] ^
+        crcslices[1][data[6]] ^ crcslices[0][data[7]];
+#else
+    c = crcslices[3][c & 0xFFu] ^ crcslices[2][c >> 8u] ^
+        crcslices[1][data[2]] ^ crcslices[0][data[3]];
+#endif
+    data += SML_CRC16_SLICES;
+    len -= SML_CRC16_SLICES;
+  }
+
+  while (len--) {
+    c = (c >> 8u) ^ (crctab[(c ^ *data++) & 0xFFu]);
+  }
+
+  crc = c;
+}
+
+void SmlCrc16::update(const unsigned char *data, size_t len,
+                      SmlCrc16 &other) {
+  uint16_t c = crc;
+  uint16_t o = other.crc;
+
+  // both chains share the loads and are independent, so they interleave
+  while (len >= SML_CRC16_SLICES) {
+    const uint16_t head = static_cast<uint16_t>(data[0] | (data[1] << 8u));
+    c ^= head;
+    o ^= head;
+#if SML_CRC16_SLICES == 8
+    const uint16_t tail = crcslices[5][data[2]] ^ crcslices[4][data[3]] ^
+                          crcslices[3][data[4]] ^ crcslices[2][data[5]] ^
+                          crcslices[1][data[6]] ^ crcslices[0][data[7]];
+    c = crcslices[7][c & 0xFFu] ^ crcslices[6][c >> 8u] ^ tail;
+    o = crcslices[7][o & 0xFFu] ^ crcslices[6][o >> 8u] ^ tail;
+#else
+    const uint16_t tail = crcslices[1][data[2]] ^ crcslices[0][data[3]];
+    c = crcslices[3][c & 0xFFu] ^ crcslices[2][c >> 8u] ^ tail;
+    o = crcslices[3][o & 0xFFu] ^ crcslices[2][o >> 8u] ^ tail;
+#endif
+    data += SML_CRC16_SLICES;
+    len -= SML_CRC16_SLICES;
+  }
+
+  while (len--) {
+    c = (c >> 8u) ^ (crctab[(c ^ *data) & 0xFFu]);
+    o = (o >> 8u) ^ (crctab[(o ^ *data) & 0xFFu]);
+    ++data;
+  }
+
+  crc = c;
+  other.crc = o;
+}
+
+uint16_t SmlCrc16::final() const {
+  uint16_t result = crc ^ 0xFFFFu;
+
+  // switch the bytes: 0xAABB to 0xBBAA
+  return ((result & 0x00FFu) << 8u) | ((result & 0xFF00u) >> 8u);
+}
@@ -1,8 +1,60 @@
+#ifndef SML_CRC_HPP
+#define SML_CRC_HPP
+
+#include <stddef.h>
 #include <stdint.h>
 
+// Number of bytes processed per step by SmlCrc16 (4 or 8). Slicing-by-8
+// needs 4 KiB of tables, slicing-by-4 needs 2 KiB.
+#ifndef SML_CRC16_SLICES
+#define SML_CRC16_SLICES 8
+#endif
+
 /** @brief Calculates the crc checksum of a string and returns it
  *  @param cp The string to compute the crc of as unsigned char*
  *  @param len The length of the string which should be used for calculating the crc as int
  *  @return the computed crc as uint16_t
 */
 uint16_t sml_crc16(unsigned char *cp, int len);
+
+/** @brief Incremental CRC16/X.25 as used by SML
+ *
+ *  Feed the data in any number of update() calls and read the result with
+ *  final(). The result equals sml_crc16() over the concatenated data, which
+ *  stays the byte-at-a-time reference implementation.
+ */
+class SmlCrc16 {
+private:
+  uint16_t crc;
+
+public:
+  SmlCrc16();
+
+  /** @brief Restarts the computation */
+  void init();
+
+  /** @brief Adds data to the checksum
+   *  @param data Pointer to the data
+   *  @param len Number of bytes
+   */
+  void update(const unsigned char *data, size_t len);
+
+  /** @brief Adds the same data to this and a second checksum in one pass
+   *  @param data Pointer to the data
+   *  @param len Number of bytes
+   *  @param other The second checksum, e.g. the one over the whole frame
+   */
+  void update(const unsigned char *data, size_t len, SmlCrc16 &other);
+
+  /** @brief Adds a single byte to the checksum
+   *  @param byte The byte
+   */
+  void update(const unsigned char byte);
+
+  /** @brief Returns the checksum of all data added since init()
+   *  @return the crc in the byte order sml_crc16() returns
+   */
+  uint16_t final() const;
+};
+
+#endif // SML_CRC_HPP
@@ -0,0 +1,121 @@
+#include "SmlFrameSync.hpp"
+#include <cstring>
+#include <stddef.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+const unsigned char SML_START_SEQUENCE[SML_START_SEQUENCE_LENGTH] = {
+    0x1b, 0x1b, 0x1b, 0x1b, 0x01, 0x01, 0x01, 0x01};
+
+static inline bool isStartSequence(const unsigned char *data) {
+  return memcmp(data, SML_START_SEQUENCE, SML_START_SEQUENCE_LENGTH) == 0;
+}
+
+#if !defined(__SSE2__) && !defined(__ARM_NEON)
+// Sets the top bit of every byte of x that is zero, exactly (no carries
+// between bytes), see "Bit Twiddling Hacks".
+static inline size_t zeroBytes(const size_t x) {
+  const size_t low7 = static_cast<size_t>(0x7F7F7F7F7F7F7F7FULL);
+  return ~(((x & low7) + low7) | x | low7);
+}
+#endif
+
+size_t sml_find_start_sequence(const unsigned char *buffer, size_t buffer_size,
+                               size_t from) {
+  if (buffer == nullptr || buffer_size < SML_START_SEQUENCE_LENGTH) {
+    return SML_NPOS;
+  }
+
+  const size_t last = buffer_size - SML_START_SEQUENCE_LENGTH;
+  size_t i = from;
+
+#if defined(__SSE2__)
+  // candidate: 0x1b at i and i+3, 0x01 at i+4 and i+7
+  const __m128i esc = _mm_set1_epi8(0x1b);
+  const __m128i one = _mm_set1_epi8(0x01);
+  for (; i + 7 + 16 <= buffer_size; i += 16) {
+    const unsigned char *p = &buffer[i];
+    __m128i m = _mm_and_si128(
+        _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)),
+                       esc),
+        _mm_cmpeq_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 3)), esc));
+    m = _mm_and_si128(
+        m, _mm_cmpeq_epi8(
+               _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 4)), one));
+    m = _mm_and_si128(
+        m, _mm_cmpeq_epi8(
+               _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 7)), one));
+
+    unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(m));
+    while (mask != 0) {
+      const size_t k = static_cast<size_t>(__builtin_ctz(mask));
+      if (isStartSequence(p + k)) {
+        return i + k;
+      }
+      mask &= mask - 1;
+    }
+  }
+#elif defined(__ARM_NEON)
+  const uint8x16_t esc = vdupq_n_u8(0x1b);
+  const uint8x16_t one = vdupq_n_u8(0x01);
+  for (; i + 7 + 16 <= buffer_size; i += 16) {
+    const unsigned char *p = &buffer[i];
+    uint8x16_t m = vandq_u8(vceqq_u8(vld1q_u8(p), esc),
+                            vceqq_u8(vld1q_u8(p + 3), esc));
+    m = vandq_u8(m, vceqq_u8(vld1q_u8(p + 4), one));
+    m = vandq_u8(m, vceqq_u8(vld1q_u8(p + 7), one));
+
+    // narrow to one nibble per byte to get a 64 bit mask
+    uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+    while (mask != 0) {
+      const size_t k = static_cast<size_t>(__builtin_ctzll(mask) / 4);
+      if (isStartSequence(p + k)) {
+        return i + k;
+      }
+      mask &= ~(0xFULL << (4 * k));
+    }
+  }
+#else
+  // SWAR: one machine word of candidates per step
+  const size_t escs = static_cast<size_t>(0x1b1b1b1b1b1b1b1bULL);
+  const size_t ones = static_cast<size_t>(0x0101010101010101ULL);
+  const size_t word = sizeof(size_t);
+  for (; i + 4 + word <= buffer_size; i += word) {
+    size_t first;
+    size_t fifth;
+    memcpy(&first, &buffer[i], sizeof(first));
+    memcpy(&fifth, &buffer[i + 4], sizeof(fifth));
+
+    if ((zeroBytes(first ^ escs) & zeroBytes(fifth ^ ones)) == 0) {
+      continue;
+    }
+
+    for (size_t k = 0; k < word; ++k) {
+      if (i + k <= last && isStartSequence(&buffer[i + k])) {
+        return i + k;
+      }
+    }
+  }
+#endif
+
+  // tail: jump from 0x1b to 0x1b
+  while (i <= last) {
+    const void *hit = memchr(&buffer[i], 0x1b, last - i + 1);
+    if (hit == nullptr) {
+      return SML_NPOS;
+    }
+    i = static_cast<size_t>(static_cast<const unsigned char *>(hit) - buffer);
+    if (isStartSequence(&buffer[i])) {
+      return i;
+    }
+    ++i;
+  }
+
+  return SML_NPOS;
+}
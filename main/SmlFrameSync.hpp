@@ -0,0 +1,31 @@
+#ifndef SML_FRAME_SYNC_HPP
+#define SML_FRAME_SYNC_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Length of the SML start sequence 1b1b1b1b01010101 */
+const int SML_START_SEQUENCE_LENGTH = 8;
+
+/** @brief Returned by offset searches that found nothing */
+const size_t SML_NPOS = static_cast<size_t>(-1);
+
+/** @brief SML start sequence 1b1b1b1b01010101 */
+extern const unsigned char SML_START_SEQUENCE[SML_START_SEQUENCE_LENGTH];
+
+/** @brief Searches the next SML start sequence in a buffer
+ *
+ *  Candidates are found 16 bytes at a time with SSE2 or NEON where available
+ *  and a word at a time (SWAR) otherwise. Only candidates with 0x1b and 0x01
+ *  in the right places are compared against the full pattern.
+ *
+ *  @param buffer The array of unsigned char to search
+ *  @param buffer_size The size of the buffer
+ *  @param from The position to start searching at
+ *  @return position of the first byte of the start sequence
+ *  @return SML_NPOS if there is no complete start sequence after from
+ */
+size_t sml_find_start_sequence(const unsigned char *buffer, size_t buffer_size,
+                               size_t from);
+
+#endif // SML_FRAME_SYNC_HPP
@@ -0,0 +1,203 @@
+#include "SmlHistory.hpp"
+#include <cmath>
+#include <cstring>
+#include <new>
+
+// one sample in raw form has to fit into an empty segment
+static const size_t MIN_SEGMENT_SIZE = 4 + 2 * SML_VARINT_MAX_LENGTH;
+
+static size_t encodeSample(SmlDeltaOfDelta &time, SmlDeltaOfDelta &value,
+                           const uint32_t t, const int64_t v, uint8_t *out) {
+  size_t length = sml_varint_encode(sml_zigzag_encode(time.encode(t)), out);
+  length +=
+      sml_varint_encode(sml_zigzag_encode(value.encode(v)), &out[length]);
+  return length;
+}
+
+SmlHistory::SmlHistory(void *storage, const size_t size, const ObisCode obis,
+                       const size_t segmentSize) {
+  // segment heads are read in place
+  const size_t alignedSize = segmentSize & ~(alignof(Segment) - 1);
+  if (storage == nullptr || size < sizeof(Header) ||
+      alignedSize < MIN_SEGMENT_SIZE || alignedSize > UINT16_MAX) {
+    return;
+  }
+  size_t count = (size - sizeof(Header)) / alignedSize;
+  if (count == 0) {
+    return;
+  }
+  if (count > UINT16_MAX) {
+    count = UINT16_MAX;
+  }
+
+  header = static_cast<Header *>(storage);
+  segments = static_cast<unsigned char *>(storage) + sizeof(Header);
+  if (header->magic == MAGIC && header->segmentSize == alignedSize &&
+      header->segmentCount == count && header->obis == obis.packed &&
+      header->first < count && header->used <= count) {
+    return; // continue the history found in the storage
+  }
+
+  header = new (storage) Header{};
+  header->magic = MAGIC;
+  header->segmentSize = static_cast<uint16_t>(alignedSize);
+  header->segmentCount = static_cast<uint16_t>(count);
+  header->obis = obis.packed;
+}
+
+SmlHistory::Segment *SmlHistory::segment(const size_t index) const {
+  return reinterpret_cast<Segment *>(segments + index * header->segmentSize);
+}
+
+size_t SmlHistory::segmentIndex(const size_t age) const {
+  return (header->first + age) % header->segmentCount;
+}
+
+void SmlHistory::openSegment() {
+  if (header->used == header->segmentCount) {
+    // drop the oldest segment
+    header->first = static_cast<uint16_t>(segmentIndex(1));
+    --header->used;
+  }
+  Segment *head = segment(segmentIndex(header->used));
+  head->count = 0;
+  head->length = 0;
+  ++header->used;
+}
+
+ObisCode SmlHistory::getObis() const {
+  return isValid() ? ObisCode{header->obis} : ObisCode{};
+}
+
+int8_t SmlHistory::getScaler() const {
+  return isValid() ? header->scaler : 0;
+}
+
+uint8_t SmlHistory::getUnit() const { return isValid() ? header->unit : 0; }
+
+size_t SmlHistory::size() const {
+  if (!isValid()) {
+    return 0;
+  }
+  size_t samples = 0;
+  for (size_t age = 0; age < header->used; ++age) {
+    samples += segment(segmentIndex(age))->count;
+  }
+  return samples;
+}
+
+void SmlHistory::clear() {
+  if (!isValid()) {
+    return;
+  }
+  header->first = 0;
+  header->used = 0;
+  header->time.reset();
+  header->value.reset();
+}
+
+bool SmlHistory::append(const uint32_t time, const int64_t value) {
+  if (!isValid()) {
+    return false;
+  }
+
+  // encode on copies, the segment might be full
+  SmlDeltaOfDelta timeEncoder = header->time;
+  SmlDeltaOfDelta valueEncoder = header->value;
+  uint8_t sample[2 * SML_VARINT_MAX_LENGTH];
+  size_t length = encodeSample(timeEncoder, valueEncoder, time, value, sample);
+
+  const size_t capacity = header->segmentSize - sizeof(Segment);
+  Segment *head =
+      header->used > 0 ? segment(segmentIndex(header->used - 1)) : nullptr;
+  if (head == nullptr || head->length + length > capacity ||
+      head->count == UINT16_MAX) {
+    openSegment();
+    head = segment(segmentIndex(header->used - 1));
+    timeEncoder.reset();
+    valueEncoder.reset();
+    length = encodeSample(timeEncoder, valueEncoder, time, value, sample);
+  }
+
+  memcpy(reinterpret_cast<uint8_t *>(head + 1) + head->length, sample, length);
+  head->length = static_cast<uint16_t>(head->length + length);
+  ++head->count;
+  header->time = timeEncoder;
+  header->value = valueEncoder;
+  return true;
+}
+
+bool SmlHistory::append(const uint32_t time, const SmlListEntry &entry) {
+  if (!isValid() || entry.obis() != getObis() ||
+      (entry.type() != SmlValueType::Unsigned &&
+       entry.type() != SmlValueType::Integer)) {
+    return false;
+  }
+
+  if (entry.scaler() != header->scaler || entry.unit() != header->unit) {
+    // all samples share scaler and unit
+    clear();
+    header->scaler = entry.scaler();
+    header->unit = entry.unit();
+  }
+  return append(time, static_cast<int64_t>(entry.iValue()));
+}
+
+size_t SmlHistory::getLast(std::span<SmlHistorySample> samples) const {
+  if (!isValid() || samples.empty()) {
+    return 0;
+  }
+
+  // find the oldest segment needed, walking back from the newest
+  size_t start = header->used;
+  size_t available = 0;
+  while (start > 0 && available < samples.size()) {
+    --start;
+    available += segment(segmentIndex(start))->count;
+  }
+
+  size_t skip = available > samples.size() ? available - samples.size() : 0;
+  size_t copied = 0;
+  for (size_t age = start; age < header->used; ++age) {
+    const bool more =
+        decodeSegment(segmentIndex(age), [&](const SmlHistorySample &sample) {
+          if (skip > 0) {
+            --skip;
+            return true;
+          }
+          samples[copied++] = sample;
+          return copied < samples.size();
+        });
+    if (!more) {
+      break;
+    }
+  }
+  return copied;
+}
+
+size_t SmlHistory::getRange(const uint32_t from, const uint32_t to,
+                            std::span<SmlHistorySample> samples) const {
+  if (!isValid() || samples.empty()) {
+    return 0;
+  }
+
+  size_t copied = 0;
+  for (size_t age = 0; age < header->used; ++age) {
+    const bool more =
+        decodeSegment(segmentIndex(age), [&](const SmlHistorySample &sample) {
+          if (sample.time < from || sample.time > to) {
+            return true;
+          }
+          samples[copied++] = sample;
+          return copied < samples.size();
+        });
+    if (!more) {
+      break;
+    }
+  }
+  return copied;
+}
+
+double SmlHistory::getScaledValue(const SmlHistorySample &sample) const {
+  return static_cast<double>(sample.value) * std::pow(10, getScaler());
+}
@@ -0,0 +1,159 @@
+#ifndef SML_HISTORY_HPP
+#define SML_HISTORY_HPP
+
+#include "SmlTypes.hpp"
+#include "SmlVarint.hpp"
+#include <span>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief One sample of a SmlHistory */
+struct SmlHistorySample {
+  uint32_t time; // actSensorTime, or valTime if the entry has one
+  int64_t value; // unscaled, see SmlHistory::getScaledValue()
+};
+
+/** @brief Fixed-memory ring of the recent values of one OBIS code
+ *
+ *  The storage is cut into segments of equal size. A segment holds
+ *  zig-zag varints of the delta-of-delta residuals (see SmlDeltaOfDelta)
+ *  of time and value, alternating, starting over with raw values in every
+ *  segment. Steady meter readings thus take two to three bytes per sample.
+ *  When the newest segment is full, the next one is opened and, if all are
+ *  in use, the oldest segment is dropped.
+ *
+ *  All state lives in the storage, none in the object. Storage in RTC
+ *  memory (RTC_DATA_ATTR) therefore keeps the history across deep sleep:
+ *  a new SmlHistory over storage that already holds a history of the same
+ *  OBIS code and layout continues it.
+ */
+class SmlHistory {
+public:
+  static const size_t DEFAULT_SEGMENT_SIZE = 64;
+
+private:
+  static const uint32_t MAGIC = 0x484c4d53; // "SMLH"
+
+  struct Header {
+    uint32_t magic;
+    uint16_t segmentSize;
+    uint16_t segmentCount;
+    uint64_t obis;
+    uint16_t first; // oldest segment
+    uint16_t used;  // number of segments holding samples
+    int8_t scaler;
+    uint8_t unit;
+    SmlDeltaOfDelta time; // encoders of the newest segment
+    SmlDeltaOfDelta value;
+  };
+
+  struct Segment {
+    uint16_t count;
+    uint16_t length; // bytes of samples following the segment head
+  };
+
+  Header *header{nullptr};
+  unsigned char *segments{nullptr};
+
+  Segment *segment(const size_t index) const;
+  size_t segmentIndex(const size_t age) const;
+  void openSegment();
+
+  /** @brief Decodes the samples of a segment
+   *  @param index Segment in storage order
+   *  @param visitor Callable as visitor(const SmlHistorySample &), returns
+   *         false to stop
+   *  @return false if the visitor stopped
+   */
+  template <typename Visitor>
+  bool decodeSegment(const size_t index, Visitor &&visitor) const;
+
+public:
+  /** @brief Creates or continues a history in caller-provided storage
+   *  @param storage Buffer aligned like std::max_align_t, has to outlive
+   *         the history
+   *  @param size Size of the buffer in bytes
+   *  @param obis The OBIS code recorded
+   *  @param segmentSize Bytes per segment, smaller segments drop fewer
+   *         samples at a time but cost more raw values
+   */
+  SmlHistory(void *storage, const size_t size, const ObisCode obis,
+             const size_t segmentSize = DEFAULT_SEGMENT_SIZE);
+
+  SmlHistory(const SmlHistory &) = delete;
+  SmlHistory &operator=(const SmlHistory &) = delete;
+
+  /** @brief Tells whether the storage holds at least one segment */
+  bool isValid() const { return header != nullptr; }
+
+  ObisCode getObis() const;
+  int8_t getScaler() const;
+  uint8_t getUnit() const;
+
+  /** @brief Returns the number of samples held */
+  size_t size() const;
+
+  /** @brief Drops all samples */
+  void clear();
+
+  /** @brief Appends an unscaled value
+   *  @param time Time stamp of the sample
+   *  @param value Unscaled value, see getScaler()
+   *  @return false if the storage is too small for a segment
+   */
+  bool append(const uint32_t time, const int64_t value);
+
+  /** @brief Appends a list entry of the recorded OBIS code
+   *
+   *  A change of scaler or unit clears the history, all samples share them.
+   *  @param time Time stamp of the sample
+   *  @param entry The entry, skipped unless it holds a number
+   *  @return false if the entry was skipped
+   */
+  bool append(const uint32_t time, const SmlListEntry &entry);
+
+  /** @brief Copies the newest samples, oldest first
+   *  @param samples Receives up to samples.size() samples
+   *  @return number of samples copied
+   */
+  size_t getLast(std::span<SmlHistorySample> samples) const;
+
+  /** @brief Copies the samples of a time range, oldest first
+   *  @param from First time stamp of the range
+   *  @param to Last time stamp of the range, inclusive
+   *  @param samples Receives up to samples.size() samples
+   *  @return number of samples copied
+   */
+  size_t getRange(const uint32_t from, const uint32_t to,
+                  std::span<SmlHistorySample> samples) const;
+
+  /** @brief Applies the scaler of the history to a sample */
+  double getScaledValue(const SmlHistorySample &sample) const;
+};
+
+template <typename Visitor>
+bool SmlHistory::decodeSegment(const size_t index, Visitor &&visitor) const {
+  const Segment *head = segment(index);
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(head + 1);
+  SmlDeltaOfDelta time;
+  SmlDeltaOfDelta value;
+  size_t position = 0;
+  for (uint16_t i = 0; i < head->count; ++i) {
+    uint64_t rawTime;
+    uint64_t rawValue;
+    if (!sml_varint_decode(data, head->length, position, rawTime) ||
+        !sml_varint_decode(data, head->length, position, rawValue)) {
+      return true;
+    }
+
+    SmlHistorySample sample;
+    sample.time = static_cast<uint32_t>(time.decode(sml_zigzag_decode(rawTime)));
+    sample.value = value.decode(sml_zigzag_decode(rawValue));
+    if (!visitor(sample)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif // SML_HISTORY_HPP
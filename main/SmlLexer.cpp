@@ -1,257 +1,311 @@
 #include "SmlLexer.hpp"
+#include <cstring>
+
+const SmlTlInfo &SmlLexer::getTlInfo(const unsigned char element) const {
+  return SML_TL_TABLE[element];
+}
+
+bool SmlLexer::hasType(const unsigned char element, const SmlTlType type,
+                       const uint8_t width) const {
+  const SmlTlInfo &tl = SML_TL_TABLE[element];
+  return tl.type == type && tl.width == width;
+}
 
 bool SmlLexer::isOctetString(const unsigned char element) const {
-  if ((element & 0xF0) != 0x00) {
+  const SmlTlInfo &tl = SML_TL_TABLE[element];
+  return tl.type == SmlTlType::OctetString && !tl.more;
+}
+
+bool SmlLexer::isExtendedOctetString(const unsigned char element) const {
+  const SmlTlInfo &tl = SML_TL_TABLE[element];
+  return tl.type == SmlTlType::OctetString && tl.more;
+}
+
+bool SmlLexer::isUnsigned8(const unsigned char element) const {
+  return hasType(element, SmlTlType::Unsigned, 1);
+}
+
+bool SmlLexer::skipElement(const unsigned char *buffer,
+                           const size_t buffer_size, size_t &position) const {
+  size_t end = position;
+  if (buffer == nullptr || !skipNested(buffer, buffer_size, end, 0)) {
     return false;
   }
+  position = end;
   return true;
 }
 
-bool SmlLexer::isExtendedOctetString(const unsigned char element) const {
-  if ((element & 0xF0) != 0x80) {
+bool SmlLexer::skipNested(const unsigned char *buffer, const size_t buffer_size,
+                          size_t &position, const int depth) const {
+  if (depth > MAX_SKIP_DEPTH) {
+    return false;
+  }
+
+  SmlTlType type;
+  int length;
+  int tlBytes;
+  if (!getTypeLength(buffer, buffer_size, position, type, length, tlBytes)) {
     return false;
   }
+  position += tlBytes;
+
+  if (type == SmlTlType::List) {
+    for (int i = 0; i < length; ++i) {
+      if (!skipNested(buffer, buffer_size, position, depth + 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  if (static_cast<size_t>(length) > buffer_size - position) {
+    return false;
+  }
+  position += length;
   return true;
 }
 
-bool SmlLexer::isUnsigned8(const unsigned char element) const {
-  if (element != 0x62) {
+bool SmlLexer::getTypeLength(const unsigned char *buffer,
+                             const size_t buffer_size, const size_t position,
+                             SmlTlType &type, int &length,
+                             int &tlBytes) const {
+  if (position >= buffer_size) {
+    return false;
+  }
+
+  const SmlTlInfo *tl = &SML_TL_TABLE[buffer[position]];
+  type = tl->type;
+  length = 0;
+  tlBytes = 0;
+  for (;;) {
+    length = (length << 4) | tl->length;
+    ++tlBytes;
+    if (!tl->more) {
+      break;
+    }
+    // at most 28 bits of length, far beyond any frame
+    if (tlBytes >= 7 || position + tlBytes >= buffer_size) {
+      return false;
+    }
+    tl = &SML_TL_TABLE[buffer[position + tlBytes]];
+  }
+
+  if (type == SmlTlType::Invalid) {
     return false;
   }
+
+  if (type != SmlTlType::List) {
+    // EndOfSmlMsg (0x00) has no payload, all other lengths include the TL
+    length = length == 0 ? 0 : length - tlBytes;
+    if (length < 0) {
+      return false;
+    }
+  }
   return true;
 }
 
 int SmlLexer::getOctetStringLength(const unsigned char element) const {
-  if (static_cast<int>(element) == 0x00) {
-    return -1;
+  const SmlTlInfo &tl = SML_TL_TABLE[element];
+  if (tl.type != SmlTlType::OctetString || tl.more) {
+    return -2;
   }
 
-  if (static_cast<int>(element) & 0xF0) {
-    return -2;
+  if (tl.length == 0) {
+    return -1;
   }
-  return static_cast<int>(element & 0x0F) - 1;
+  return static_cast<int>(tl.length) - 1;
 }
 
 int SmlLexer::getExtendedOctetStringLength(const unsigned char *buffer,
-                                           const int buffer_size,
-                                           int &position) {
+                                           const size_t buffer_size,
+                                           size_t &position) {
   int retval{0};
-  int tl{0};
+  int tlBytes{0};
 
+  if (position >= buffer_size) {
+    return -3;
+  }
+
+  const SmlTlInfo *tl = &SML_TL_TABLE[buffer[position]];
   if (buffer[position] == 0x00) {
     return -1;
   }
 
-  if ((buffer[position] & 0xF0) != 0x80) {
+  if (tl->type != SmlTlType::OctetString || !tl->more) {
     return -2;
   }
 
-  if (position >= buffer_size) {
-    return -3;
-  }
-
   do {
-    retval = retval << 4;
-    retval |= (buffer[position] & 0x0F);
+    retval = (retval << 4) | tl->length;
     ++position;
-    ++tl;
-  } while ((buffer[position] & 0xF0) == 0x80);
+    ++tlBytes;
+    if (position >= buffer_size) {
+      return -3;
+    }
+    tl = &SML_TL_TABLE[buffer[position]];
+  } while (tl->more);
 
-  retval = retval << 4;
-  retval |= (buffer[position] & 0x0F);
+  retval = (retval << 4) | tl->length;
   ++position;
-  ++tl;
+  ++tlBytes;
 
-  return retval - tl;
+  return retval - tlBytes;
 }
 
-uint8_t SmlLexer::getUnsigned8(const unsigned char *buffer, int buffer_size,
-                               int &position) {
-  int8_t retval = 0;
-  if (position >= buffer_size - 1) {
-    return 0xFF;
+// Loads the width byte big-endian number at data left-aligned into the upper
+// bytes of a uint64_t. If the buffer holds at least 8 bytes from data on, a
+// single unaligned load plus byte swap is used and the surplus low bytes are
+// shifted out by the caller.
+static inline uint64_t loadBigEndian(const unsigned char *data,
+                                     const uint8_t width,
+                                     const bool canLoad64) {
+  uint64_t value = 0;
+  if (canLoad64) {
+    memcpy(&value, data, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+  }
+
+  for (uint8_t i = 0; i < width; ++i) {
+    value = (value << 8) | data[i];
+  }
+  return value << (64 - 8 * width);
+}
+
+bool SmlLexer::decodeNumber(const unsigned char *buffer,
+                            const size_t buffer_size, size_t &position,
+                            const SmlTlType type, const uint8_t width,
+                            uint64_t &value) const {
+  if (position >= buffer_size) {
+    return false;
   }
 
-  if (buffer[position] != 0x62) {
-    return 0xFF;
+  const SmlTlInfo &tl = SML_TL_TABLE[buffer[position]];
+  if (tl.type != type || tl.width == 0) {
+    return false;
   }
 
-  ++position;
-  retval = static_cast<int>(buffer[position]);
-  ++position;
-  return retval;
-}
+  if (width != 0 && tl.width != width) {
+    return false;
+  }
 
-int8_t SmlLexer::getInteger8(const unsigned char *buffer, const int buffer_size,
-                             int &position) {
-  int8_t retval = 0;
-  if (position >= buffer_size - 1) {
-    return 0xFF;
+  if (position + 1 + tl.width > buffer_size) {
+    return false;
   }
 
-  if (buffer[position] != 0x52) {
-    return 0xFF;
+  const bool canLoad64 = position + 1 + 8 <= buffer_size;
+  const uint64_t raw =
+      loadBigEndian(&buffer[position + 1], tl.width, canLoad64);
+  const int shift = 64 - 8 * tl.width;
+
+  if (type == SmlTlType::Integer) {
+    // arithmetic shift sign-extends the most significant payload bit
+    value = static_cast<uint64_t>(static_cast<int64_t>(raw) >> shift);
+  } else {
+    value = raw >> shift;
   }
 
-  ++position;
-  retval = int8_t(buffer[position]);
-  
-  ++position;
-  return int8_t(retval);
+  position += 1 + tl.width;
+  return true;
 }
 
-uint16_t SmlLexer::getUnsigned16(const unsigned char *buffer,
-                                 const int buffer_size, int &position) {
-  int16_t retval = 0;
-  if (position >= static_cast<int>(buffer_size - 2)) {
-    return 0xFFFF;
+uint8_t SmlLexer::getUnsigned8(const unsigned char *buffer, size_t buffer_size,
+                               size_t &position) {
+  uint64_t retval = 0;
+  if (!decodeNumber(buffer, buffer_size, position, SmlTlType::Unsigned, 1,
+                    retval)) {
+    return 0xFF;
   }
+  return static_cast<uint8_t>(retval);
+}
 
-  if (buffer[position] != 0x63) {
-    return 0xFFFF;
+int8_t SmlLexer::getInteger8(const unsigned char *buffer,
+                             const size_t buffer_size, size_t &position) {
+  uint64_t retval = 0;
+  if (!decodeNumber(buffer, buffer_size, position, SmlTlType::Integer, 1,
+                    retval)) {
+    return static_cast<int8_t>(0xFF);
   }
-
-  ++position;
-  retval = buffer[position] << 8;
-  ++position;
-  retval = retval | buffer[position];
-  ++position;
-  return retval;
+  return static_cast<int8_t>(retval);
 }
 
-int16_t SmlLexer::getInteger16(const unsigned char *buffer,
-                               const int buffer_size, int &position) {
-  int16_t retval = 0;
-  if (position >= static_cast<int>(buffer_size - 2)) {
+uint16_t SmlLexer::getUnsigned16(const unsigned char *buffer,
+                                 const size_t buffer_size, size_t &position) {
+  uint64_t retval = 0;
+  if (!decodeNumber(buffer, buffer_size, position, SmlTlType::Unsigned, 2,
+                    retval)) {
     return 0xFFFF;
   }
+  return static_cast<uint16_t>(retval);
+}
 
-  if (buffer[position] != 0x53) {
-    return 0xFFFF;
+int16_t SmlLexer::getInteger16(const unsigned char *buffer,
+                               const size_t buffer_size, size_t &position) {
+  uint64_t retval = 0;
+  if (!decodeNumber(buffer, buffer_size, position, SmlTlType::Integer, 2,
+                    retval)) {
+    return static_cast<int16_t>(0xFFFF);
   }
-
-  ++position;
-  retval = buffer[position] << 8;
-  ++position;
-  retval = retval | buffer[position];
-  ++position;
-  return retval;
+  return static_cast<int16_t>(retval);
 }
 
 uint32_t SmlLexer::getUnsigned32(const unsigned char *buffer,
-                                 const int buffer_size, int &position) {
-  int32_t retval = 0;
-  if (position >= static_cast<int>(buffer_size - 4)) {
-    return 0xFFFFFFFF;
-  }
-
-  if (buffer[position] != 0x65) {
+                                 const size_t buffer_size, size_t &position) {
+  uint64_t retval = 0;
+  if (!decodeNumber(buffer, buffer_size, position, SmlTlType::Unsigned, 4,
+                    retval)) {
     return 0xFFFFFFFF;
   }
-
-  ++position;
-  retval = buffer[position] << 24;
-  ++position;
-  retval = retval | buffer[position] << 16;
-  ++position;
-  retval = retval | buffer[position] << 8;
-  ++position;
-  retval = retval | buffer[position];
-  ++position;
-  return retval;
+  return static_cast<uint32_t>(retval);
 }
 
 int32_t SmlLexer::getInteger32(const unsigned char *buffer,
-                               const int buffer_size, int &position) {
-  int32_t retval = 0;
-  if (position >= static_cast<int>(buffer_size - 4)) {
-    return 0xFFFFFFFF;
-  }
-
-  if (buffer[position] != 0x55) {
-    return 0xFFFFFFFF;
+                               const size_t buffer_size, size_t &position) {
+  uint64_t retval = 0;
+  if (!decodeNumber(buffer, buffer_size, position, SmlTlType::Integer, 4,
+                    retval)) {
+    return static_cast<int32_t>(0xFFFFFFFF);
   }
-
-  ++position;
-  retval = buffer[position] << 24;
-  ++position;
-  retval = retval | buffer[position] << 16;
-  ++position;
-  retval = retval | buffer[position] << 8;
-  ++position;
-  retval = retval | buffer[position];
-  ++position;
-  return retval;
+  return static_cast<int32_t>(retval);
 }
 
 uint64_t SmlLexer::getUnsigned64(const unsigned char *buffer,
-                                 const int buffer_size, int &position) {
-  int64_t retval = 0;
-  if (position >= static_cast<int>(buffer_size - 8)) {
-    return 0xFFFFFFFFFFFFFFFF;
-  }
-
-  if (buffer[position] != 0x69) {
+                                 const size_t buffer_size, size_t &position) {
+  uint64_t retval = 0;
+  if (!decodeNumber(buffer, buffer_size, position, SmlTlType::Unsigned, 8,
+                    retval)) {
     return 0xFFFFFFFFFFFFFFFF;
   }
-
-  ++position;
-  retval = static_cast<int64_t>(buffer[position]) << 56;
-  ++position;
-  retval = retval | static_cast<int64_t>(buffer[position]) << 48;
-  ++position;
-  retval = retval | static_cast<int64_t>(buffer[position]) << 40;
-  ++position;
-  retval = retval | static_cast<int64_t>(buffer[position]) << 32;
-  ++position;
-  retval = retval | static_cast<int64_t>(buffer[position]) << 24;
-  ++position;
-  retval = retval | static_cast<int64_t>(buffer[position]) << 16;
-  ++position;
-  retval = retval | static_cast<int64_t>(buffer[position]) << 8;
-  ++position;
-  retval = retval | static_cast<int64_t>(buffer[position]);
-  ++position;
-
   return retval;
 }
 
 int64_t SmlLexer::getInteger64(const unsigned char *buffer,
-                               const int buffer_size, int &position) {
-  int64_t retval = 0;
-  if (position >= static_cast<int>(buffer_size - 8)) {
-    return 0xFFFFFFFFFFFFFFFF;
-  }
-
-  if (buffer[position] != 0x59) {
-    return 0xFFFFFFFFFFFFFFFF;
-  }
-
-  ++position;
-  uint8_t shift = 0;
-  for(int i=0; i<8; i++) {
-    shift = 63-(8*(i+1)-1);
-    retval |= int64_t(buffer[position]) << shift;
-    ++position;
+                               const size_t buffer_size, size_t &position) {
+  uint64_t retval = 0;
+  if (!decodeNumber(buffer, buffer_size, position, SmlTlType::Integer, 8,
+                    retval)) {
+    return static_cast<int64_t>(0xFFFFFFFFFFFFFFFF);
   }
-
-  return retval;
+  return static_cast<int64_t>(retval);
 }
 
 uint8_t SmlLexer::getSmlListLength(const unsigned char *buffer,
-                                   const int position) {
-  if ((buffer[position] & 0xF0) != 0x70) {
+                                   const size_t position) {
+  const SmlTlInfo &tl = SML_TL_TABLE[buffer[position]];
+  if (tl.type != SmlTlType::List || tl.more) {
     return 0xFF;
   }
 
-  return buffer[position] & 0x0F;
+  return tl.length;
 }
 
-SmlTime SmlLexer::getSmlTime(const unsigned char *buffer, const int buffer_size,
-                             int &position) {
+SmlTime SmlLexer::getSmlTime(const unsigned char *buffer,
+                             const size_t buffer_size, size_t &position) {
   SmlTime retval{SmlTimeType::secIndex, 0xFFFFFFFF};
 
-  if (buffer[position] != 0x72) {
+  if (getSmlListLength(buffer, position) != 2) {
     SmlLogger::Warning("Syntax error in line %d. Expected 0x72 but found %02x",
                        __LINE__, buffer[position]);
     return retval;
@@ -284,105 +338,65 @@ SmlTime SmlLexer::getSmlTime(const unsigned char *buffer, const int buffer_size,
 }
 
 uint64_t SmlLexer::getSmlStatus(const unsigned char *buffer,
-                                const int buffer_size, int &position) {
+                                const size_t buffer_size, size_t &position) {
   uint64_t retval = 0xFFFFFFFFFFFFFFFF;
 
-  if (position >= static_cast<int>(buffer_size) - 1) {
+  if (position + 1 >= buffer_size) {
     return retval;
   }
 
-  switch (buffer[position]) {
-  case 0x62:
-    retval = static_cast<uint64_t>(getUnsigned8(buffer, buffer_size, position));
-    break;
-  case 0x63:
-    retval =
-        static_cast<uint64_t>(getUnsigned16(buffer, buffer_size, position));
-    break;
-  case 0x65:
-    retval =
-        static_cast<uint64_t>(getUnsigned32(buffer, buffer_size, position));
-    break;
-  case 0x69:
-    retval = getUnsigned64(buffer, buffer_size, position);
-    break;
+  if (SML_TL_TABLE[buffer[position]].type == SmlTlType::Unsigned) {
+    retval = getUnsigned(buffer, buffer_size, position);
   }
 
   return retval;
 }
 
 uint64_t SmlLexer::getUnsigned(const unsigned char *buffer,
-                               const int buffer_size, int &position) {
-  uint64_t retval = 0xFFFFFFFFFFFFFFFF;
-  if (buffer[position] == 0x62) {
-    retval = static_cast<uint64_t>(getUnsigned8(buffer, buffer_size, position));
-  }
-
-  if (buffer[position] == 0x63) {
-    retval = static_cast<uint64_t>(getUnsigned16(buffer, buffer_size, position));
-  }
-
-  if (buffer[position] == 0x65) {
-    retval = static_cast<uint64_t>(getUnsigned32(buffer, buffer_size, position));
-  }
-
-  if (buffer[position] == 0x69) {
-    retval = getUnsigned64(buffer, buffer_size, position);
+                               const size_t buffer_size, size_t &position) {
+  uint64_t retval = 0;
+  if (!decodeNumber(buffer, buffer_size, position, SmlTlType::Unsigned, 0,
+                    retval)) {
+    return 0xFFFFFFFFFFFFFFFF;
   }
-
   return retval;
 }
 
-int64_t SmlLexer::getInteger(const unsigned char *buffer, const int buffer_size,
-                             int &position) {
-  uint64_t retval = 0xFFFFFFFFFFFFFFFF;
-  if (buffer[position] == 0x52) {
-    retval = static_cast<int64_t>(getInteger8(buffer, buffer_size, position));
-  }
-
-  if (buffer[position] == 0x53) {
-    retval = static_cast<int64_t>(getInteger16(buffer, buffer_size, position));
-  }
-
-  if (buffer[position] == 0x55) {
-    retval = static_cast<int64_t>(getInteger32(buffer, buffer_size, position));
-  }
-
-  if (buffer[position] == 0x59) {
-    retval = getInteger64(buffer, buffer_size, position);
+int64_t SmlLexer::getInteger(const unsigned char *buffer,
+                             const size_t buffer_size, size_t &position) {
+  uint64_t retval = 0;
+  if (!decodeNumber(buffer, buffer_size, position, SmlTlType::Integer, 0,
+                    retval)) {
+    return static_cast<int64_t>(0xFFFFFFFFFFFFFFFF);
   }
-
-  return retval;
+  return static_cast<int64_t>(retval);
 }
 
-std::string SmlLexer::getOctetString(const unsigned char *buffer,
-                                     const int buffer_size, int &position,
-                                     const int length) {
-  std::string ret = "";
+SmlBytesView SmlLexer::getOctetString(const unsigned char *buffer,
+                                      const size_t buffer_size,
+                                      size_t &position, const int length) {
+  SmlBytesView ret;
   if (buffer == nullptr) {
     return ret;
   }
 
-  if (length == 0) {
+  if (length <= 0) {
     return ret;
   }
 
-  if (buffer_size < (position + length)) {
+  if (buffer_size < position + static_cast<size_t>(length)) {
     return ret;
   }
 
-  for (int i = 0; i < length; i++) {
-    ret += buffer[position + i];
-  }
-
+  ret.data = &buffer[position];
+  ret.length = static_cast<size_t>(length);
   return ret;
 }
 
-std::string
-SmlLexer::getExtendedOctetString(const unsigned char *buffer,
-                                         const int buffer_size, int &position,
-                                         int length) {
-  std::string ret = "";
+SmlBytesView SmlLexer::getExtendedOctetString(const unsigned char *buffer,
+                                              const size_t buffer_size,
+                                              size_t &position, int length) {
+  SmlBytesView ret;
   if (buffer == nullptr) {
     return ret;
   }
@@ -391,17 +405,11 @@ SmlLexer::getExtendedOctetString(const unsigned char *buffer,
     return ret;
   }
 
-  if (static_cast<int>(buffer_size) < (position + length)) {
+  if (buffer_size < position + static_cast<size_t>(length)) {
     return ret;
   }
 
-  while ((buffer[position] & 0xF0) == 0x80) {
-    ++position;
-  }
-
-  for (int i = 0; i < length; i++) {
-    ret += buffer[position + i];
-  }
-
+  ret.data = &buffer[position];
+  ret.length = static_cast<size_t>(length);
   return ret;
-}
\ No newline at end of file
+}
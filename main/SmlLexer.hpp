@@ -2,12 +2,77 @@
 #define SML_LEXER_HPP
 
 #include "SmlLogger.hpp"
+#include "SmlTypeLength.hpp"
 #include "SmlTypes.hpp"
 #include <stdint.h>
 
 class SmlLexer {
+private:
+  /** @brief Checks type and payload width of a TL byte via SML_TL_TABLE
+   *  @param element The TL byte to check
+   *  @param type The expected type
+   *  @param width The expected payload width in bytes, 0 for non-integers
+   *  @return true if the TL byte matches
+   */
+  bool hasType(const unsigned char element, const SmlTlType type,
+               const uint8_t width) const;
+
+  /** @brief Decodes a big-endian Unsigned or Integer of 1..8 bytes
+   *  @param buffer Pointer to a array of unsigned char
+   *  @param buffer_size Size of the buffer to lex
+   *  @param position Position of the TL byte, advanced past the value
+   *  @param type SmlTlType::Unsigned or SmlTlType::Integer
+   *  @param width Required payload width, 0 accepts any width
+   *  @param value The decoded value, sign-extended for Integer
+   *  @return true on success
+   *  @return false if the TL byte does not match or the buffer is too short
+   */
+  bool decodeNumber(const unsigned char *buffer, const size_t buffer_size,
+                    size_t &position, const SmlTlType type, const uint8_t width,
+                    uint64_t &value) const;
+
+  /** @brief Recursive part of skipElement()
+   *  @param depth Nesting level of the element, bounded by MAX_SKIP_DEPTH
+   */
+  bool skipNested(const unsigned char *buffer, const size_t buffer_size,
+                  size_t &position, const int depth) const;
+
+  static const int MAX_SKIP_DEPTH = 16;
 
 public:
+  /** @brief Classifies a TL byte
+   *  @param element The TL byte as unsigned char
+   *  @return Entry of SML_TL_TABLE describing type, length and width
+   */
+  const SmlTlInfo &getTlInfo(const unsigned char element) const;
+
+  /** @brief Skips one element, including nested lists, using only the TL
+   *  fields. Nothing is decoded or logged.
+   *  @param buffer Pointer to a array of unsigned char
+   *  @param buffer_size Size of the buffer to lex
+   *  @param position Position of the TL byte, advanced past the element
+   *  @return true on success
+   *  @return false on an invalid TL field or if the element exceeds the
+   *  buffer, position is left unchanged then
+   */
+  bool skipElement(const unsigned char *buffer, const size_t buffer_size,
+                   size_t &position) const;
+
+  /** @brief Reads a (possibly extended) TL field
+   *  @param buffer Pointer to a array of unsigned char
+   *  @param buffer_size Size of the buffer to lex
+   *  @param position Position of the first TL byte
+   *  @param type Receives the type of the element
+   *  @param length Receives the number of elements for lists and the number
+   *         of payload bytes (without the TL field) for all other types
+   *  @param tlBytes Receives the size of the TL field
+   *  @return true on success
+   *  @return false on an invalid or truncated TL field
+   */
+  bool getTypeLength(const unsigned char *buffer, const size_t buffer_size,
+                     const size_t position, SmlTlType &type, int &length,
+                     int &tlBytes) const;
+
   /** @brief Checks if a vector element is a SML Octet string
    *  @param element The element to check as char
    *  @return true if element is a SML octet string
@@ -45,7 +110,7 @@ public:
    *  @return -2 if the element to check is not of type octet string
    */
   int getExtendedOctetStringLength(const unsigned char *buffer,
-                                   const int buffer_size, int &position);
+                                   const size_t buffer_size, size_t &position);
 
   /** @brief Gets a SML Unsigned8 from vector of chars
    *  @param data Pointer to a vector of char
@@ -53,8 +118,8 @@ public:
    *  @return Unsigned8
    *  @return 0xFF on error
    */
-  uint8_t getUnsigned8(const unsigned char *buffer, int buffer_size,
-                       int &position);
+  uint8_t getUnsigned8(const unsigned char *buffer, size_t buffer_size,
+                       size_t &position);
 
   /** @brief Gets a SML Signed8 from vector of chars
    *  @param buffer Pointer to a array of unsigned char
@@ -63,8 +128,8 @@ public:
    *  @return Signed8
    *  @return 0xFF on error
    */
-  int8_t getInteger8(const unsigned char *buffer, const int buffer_size,
-                     int &position);
+  int8_t getInteger8(const unsigned char *buffer, const size_t buffer_size,
+                     size_t &position);
 
   /** @brief Gets a SML Unsigned16 from array of unsignd chars
    *  @param data Pointer to a vector of char
@@ -73,8 +138,8 @@ public:
    *  @return Unsigned16
    *  @return 0xFFFF on error
    */
-  uint16_t getUnsigned16(const unsigned char *buffer, const int buffer_size,
-                         int &position);
+  uint16_t getUnsigned16(const unsigned char *buffer, const size_t buffer_size,
+                         size_t &position);
 
   /** @brief Gets a SML Integer16 from vector of chars
    *  @param data Pointer to a array of unsigned char
@@ -83,8 +148,8 @@ public:
    *  @return Integer16
    *  @return 0xFFFF on error
    */
-  int16_t getInteger16(const unsigned char *buffer, const int buffer_size,
-                       int &position);
+  int16_t getInteger16(const unsigned char *buffer, const size_t buffer_size,
+                       size_t &position);
 
   /** @brief Gets a SML Unsigned32 from vector of chars
    *  @param data Pointer to a array of unsigned char
@@ -93,8 +158,8 @@ public:
    *  @return Unsigned32
    *  @return 0xFFFFFFFF on error
    */
-  uint32_t getUnsigned32(const unsigned char *buffer, const int buffer_size,
-                         int &position);
+  uint32_t getUnsigned32(const unsigned char *buffer, const size_t buffer_size,
+                         size_t &position);
 
   /** @brief Gets a SML Integer32 from vector of chars
    *  @param data Pointer to a array of unsigned char
@@ -103,8 +168,8 @@ public:
    *  @return Integer32
    *  @return 0xFFFFFFFF on error
    */
-  int32_t getInteger32(const unsigned char *buffer, const int bufer_size,
-                       int &position);
+  int32_t getInteger32(const unsigned char *buffer, const size_t buffer_size,
+                       size_t &position);
 
   /** @brief Gets a SML Unsigned64 from vector of chars
    *  @param data Pointer to a array of unsigned char
@@ -113,8 +178,8 @@ public:
    *  @return Unsigned64
    *  @return 0xFFFFFFFFFFFFFFFF on error
    */
-  uint64_t getUnsigned64(const unsigned char *buffer, const int buffer_size,
-                         int &position);
+  uint64_t getUnsigned64(const unsigned char *buffer, const size_t buffer_size,
+                         size_t &position);
 
   /** @brief Gets a SML Integer64 from vector of chars
    *  @param data Pointer to a array of unsigned char
@@ -123,8 +188,8 @@ public:
    *  @return Integer64
    *  @return 0xFFFFFFFFFFFFFFFF on error
    */
-  int64_t getInteger64(const unsigned char *buffer, const int buffer_size,
-                       int &position);
+  int64_t getInteger64(const unsigned char *buffer, const size_t buffer_size,
+                       size_t &position);
 
   /** @brief Get number of elements in a SML list
    *  @param buffer Pointer to a array of unsigned char
@@ -133,7 +198,7 @@ public:
    *  @return number of list elements as uint8_t
    *  @return 0xFF in case of an error
    */
-  uint8_t getSmlListLength(const unsigned char *buffer, const int position);
+  uint8_t getSmlListLength(const unsigned char *buffer, const size_t position);
 
   /** @brief Get SMl time stamp value
    *  @param buffer Pointer to a array of unsigned char
@@ -141,8 +206,8 @@ public:
    *  @param position Pointer to the position of the list
    *  @return SMl time stamp as uint32_t
    */
-  SmlTime getSmlTime(const unsigned char *buffer, const int buffer_size,
-                     int &position);
+  SmlTime getSmlTime(const unsigned char *buffer, const size_t buffer_size,
+                     size_t &position);
 
   /** @brief Gets a SML status as uint64_t from vector of chars
    *  @param buffer Pointer to a array of unsigned char
@@ -151,49 +216,51 @@ public:
    *  @return Unsigned64
    *  @return 0xFFFFFFFFFFFFFFFF on error
    */
-  uint64_t getSmlStatus(const unsigned char *buffer, const int buffer_size,
-                        int &position);
+  uint64_t getSmlStatus(const unsigned char *buffer, const size_t buffer_size,
+                        size_t &position);
 
-  /** @brief Gets a Unsigned (8/16/32/64) as uint64_t from vector of chars
+  /** @brief Gets a Unsigned of any width (1..8 bytes) as uint64_t
    *  @param buffer Pointer to a array of unsigned char
    *  @param buffer_size Size of the buffer to lex
    *  @param position Pointer to the position of the octet string
    *  @return Unsigned64
    *  @return 0xFFFFFFFFFFFFFFFF on error
    */
-  uint64_t getUnsigned(const unsigned char *buffer, const int buffer_size,
-                       int &position);
+  uint64_t getUnsigned(const unsigned char *buffer, const size_t buffer_size,
+                       size_t &position);
 
-  /** @brief Gets a Integer(8/16/32/64) as int64_t from vector of chars
+  /** @brief Gets a sign-extended Integer of any width (1..8 bytes)
    *  @param buffer Pointer to a array of unsigned char
    *  @param buffer_size Size of the buffer to lex
    *  @param position Pointer to the position of the octet string
    *  @return Integer64
    *  @return 0xFFFFFFFFFFFFFFFF on error
    */
-  int64_t getInteger(const unsigned char *buffer, const int buffer_size,
-                     int &position);
+  int64_t getInteger(const unsigned char *buffer, const size_t buffer_size,
+                     size_t &position);
 
-  /** @brief returns a SML octet string as std::string
+  /** @brief returns a view of a SML octet string inside the buffer
    *  @param buffer Pointer to a array of unsigned char
    *  @param buffer_size Size of the buffer to lex
    *  @param position Pointer to the position of the octet string
    *  @param The length of the octet string to return
-   *  @return std::string
+   *  @return SmlBytesView pointing into buffer, empty on error
    */
-  std::string getOctetString(const unsigned char *buffer, const int buffer_size,
-                             int &position, const int length);
+  SmlBytesView getOctetString(const unsigned char *buffer,
+                              const size_t buffer_size, size_t &position,
+                              const int length);
 
-  /** @brief returns a SML octet string as std::string
+  /** @brief returns a view of a SML octet string with extended TL field
    *  @param buffer Pointer to a array of unsigned char
    *  @param buffer_size Size of the buffer to lex
-   *  @param position Pointer to the position of the octet string
+   *  @param position Position of the payload, behind the TL bytes read by
+   *         getExtendedOctetStringLength()
    *  @param The length of the octet string to return
-   *  @return std::string
+   *  @return SmlBytesView pointing into buffer, empty on error
    */
-  std::string getExtendedOctetString(const unsigned char *buffer,
-                                           const int buffer_size, int &position,
-                                           int length);
+  SmlBytesView getExtendedOctetString(const unsigned char *buffer,
+                                      const size_t buffer_size,
+                                      size_t &position, int length);
 };
 
 #endif // SML_LEXER_HPP
\ No newline at end of file
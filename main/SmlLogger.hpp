@@ -1,5 +1,6 @@
 #pragma once
 
+#include "SmlTypes.hpp"
 #include <stdio.h>
 #include <string>
 
@@ -25,6 +26,13 @@ private:
     printf("\033[0;37m");
   }
 
+  static void printBytes(const SmlBytesView &bytes) {
+    for (size_t i = 0; i < bytes.size(); ++i) {
+      printf("%02x ", bytes[i]);
+    }
+    printf("\n");
+  }
+
 public:
   static void setSmlLogLevel(SmlLogLevel newLogLevel) {
     logLevel = newLogLevel;
@@ -62,6 +70,20 @@ public:
     }
   }
 
+  static void Debug(const char *message, const SmlBytesView &bytes) {
+    if (logLevel <= SmlLogLevel::Debug) {
+      printLogMessage("Debug", message, SmlLogColor_White);
+      printBytes(bytes);
+    }
+  }
+
+  static void Info(const char *message, const SmlBytesView &bytes) {
+    if (logLevel <= SmlLogLevel::Info) {
+      printLogMessage("Info", message, SmlLogColor_White);
+      printBytes(bytes);
+    }
+  }
+
   template <typename... Args>
   static void Warning(const char *message, Args... args) {
     if (logLevel <= SmlLogLevel::Warning) {
@@ -3,6 +3,7 @@
 
 #include "SmlTypes.hpp"
 #include <memory>
+#include <memory_resource>
 #include <vector>
 
 struct SmlMessageBody {
@@ -10,26 +11,41 @@ struct SmlMessageBody {
 };
 
 struct SmlPublicOpenRes : SmlMessageBody {
-    std::string codePage;
-    std::string clientId;
-    std::string reqField;
-    std::string serverId;
+    SmlBytesView codePage;
+    SmlBytesView clientId;
+    SmlBytesView reqField;
+    SmlBytesView serverId;
     SmlTime refTime;
     uint8_t smlVersion{1};
 };
 
 struct SmlPublicCloseRes : SmlMessageBody {
-    std::string globalSignature;
+    SmlBytesView globalSignature;
 };
 
 struct SmlGetListRes : SmlMessageBody {
-    std::string clientId;
-    std::string serverId;
-    std::string listName;
+    explicit SmlGetListRes(std::pmr::memory_resource *resource =
+                               std::pmr::get_default_resource())
+        : valList(resource) {}
+
+    SmlBytesView clientId;
+    SmlBytesView serverId;
+    SmlBytesView listName;
     SmlTime actSensorTime;
-    std::vector<SmlListEntry> valList;
-    std::string listSignature;
+    std::pmr::vector<SmlListEntry> valList;
+    SmlBytesView listSignature;
     SmlTime actGatewayTime;
+
+    /** @brief Resets all fields, valList keeps its capacity */
+    void clear() {
+        clientId = SmlBytesView{};
+        serverId = SmlBytesView{};
+        listName = SmlBytesView{};
+        actSensorTime = SmlTime{};
+        valList.clear();
+        listSignature = SmlBytesView{};
+        actGatewayTime = SmlTime{};
+    }
 };
 
 #endif // SML_MESSAGE_BODY_HPP
\ No newline at end of file
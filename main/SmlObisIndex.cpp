@@ -0,0 +1,54 @@
+#include "SmlObisIndex.hpp"
+
+SmlObisIndex::SmlObisIndex() { clear(); }
+
+int SmlObisIndex::slotOf(const ObisCode code) {
+  // Fibonacci hashing, the top bits of the product are well mixed
+  return static_cast<int>((code.packed * 0x9E3779B97F4A7C15ULL) >>
+                          (64 - SLOT_BITS));
+}
+
+void SmlObisIndex::clear() {
+  for (int i = 0; i < SLOTS; ++i) {
+    positions[i] = EMPTY;
+  }
+  count = 0;
+  overflow = false;
+}
+
+bool SmlObisIndex::insert(const ObisCode code, const uint16_t position) {
+  if (!code.isValid()) {
+    return false;
+  }
+
+  if (count >= MAX_ENTRIES) {
+    overflow = true;
+    return false;
+  }
+
+  int slot = slotOf(code);
+  while (positions[slot] != EMPTY) {
+    if (keys[slot] == code.packed) {
+      return true;
+    }
+    slot = (slot + 1) & (SLOTS - 1);
+  }
+
+  keys[slot] = code.packed;
+  positions[slot] = position;
+  ++count;
+  return true;
+}
+
+int SmlObisIndex::find(const ObisCode code) const {
+  int slot = slotOf(code);
+  while (positions[slot] != EMPTY) {
+    if (keys[slot] == code.packed) {
+      return positions[slot];
+    }
+    slot = (slot + 1) & (SLOTS - 1);
+  }
+  return -1;
+}
+
+bool SmlObisIndex::isIncomplete() const { return overflow; }
@@ -0,0 +1,53 @@
+#ifndef SML_OBIS_INDEX_HPP
+#define SML_OBIS_INDEX_HPP
+
+#include "SmlTypes.hpp"
+#include <stdint.h>
+
+/** @brief Open-addressing hash index from OBIS code to valList position
+ *
+ *  The table has a fixed size and lives inside the parser, so filling and
+ *  clearing it never allocates. Codes that occur more than once keep their
+ *  first position, like the linear search did.
+ */
+class SmlObisIndex {
+private:
+  static const int SLOT_BITS = 6;
+  static const int SLOTS = 1 << SLOT_BITS;
+  static const int MAX_ENTRIES = SLOTS * 3 / 4;
+  static const uint16_t EMPTY = 0xFFFF;
+
+  uint64_t keys[SLOTS];
+  uint16_t positions[SLOTS];
+  int count;
+  bool overflow;
+
+  static int slotOf(const ObisCode code);
+
+public:
+  SmlObisIndex();
+
+  /** @brief Removes all codes */
+  void clear();
+
+  /** @brief Adds a code
+   *  @param code The OBIS code of the list entry
+   *  @param position The position of the entry in valList
+   *  @return true if the code is indexed
+   *  @return false if the code is invalid or the index is full
+   */
+  bool insert(const ObisCode code, const uint16_t position);
+
+  /** @brief Looks up a code
+   *  @param code The OBIS code to search for
+   *  @return position of the entry in valList, -1 if not indexed
+   */
+  int find(const ObisCode code) const;
+
+  /** @brief Tells whether entries were dropped because the index was full
+   *  @return true if a failed find() has to fall back to a linear search
+   */
+  bool isIncomplete() const;
+};
+
+#endif // SML_OBIS_INDEX_HPP
@@ -0,0 +1,89 @@
+#ifndef SML_OBIS_SET_HPP
+#define SML_OBIS_SET_HPP
+
+#include "SmlTypes.hpp"
+#include <array>
+#include <stddef.h>
+
+/** @brief Non-owning view of a sorted set of OBIS codes
+ *
+ *  A default constructed filter is inactive and lets every code pass.
+ */
+class SmlObisFilter {
+private:
+  const ObisCode *codes{nullptr};
+  size_t count{0};
+
+public:
+  constexpr SmlObisFilter() = default;
+
+  /** @brief Creates a filter over sorted codes
+   *  @param t_codes Pointer to the codes, sorted ascending by packed
+   *  @param t_count Number of codes
+   */
+  constexpr SmlObisFilter(const ObisCode *t_codes, const size_t t_count)
+      : codes{t_codes}, count{t_count} {}
+
+  /** @brief Tells whether the filter restricts anything
+   *  @return false if the filter lets every code pass
+   */
+  constexpr bool isActive() const { return codes != nullptr; }
+
+  /** @brief Checks a code by binary search
+   *  @param code The OBIS code to check
+   *  @return true if the code is in the set
+   */
+  constexpr bool contains(const ObisCode code) const {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+      const size_t middle = low + (high - low) / 2;
+      if (codes[middle].packed < code.packed) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    return low < count && codes[low] == code;
+  }
+};
+
+/** @brief Compile-time set of OBIS codes
+ *
+ *  The codes are sorted while the set is constructed, so a
+ *  static constexpr SmlObisSet costs no startup time:
+ *  static constexpr SmlObisSet wanted{OBIS_TOTAL_ENERGY, OBIS_SUM_ACT_INST_PWR};
+ */
+template <size_t N> class SmlObisSet {
+private:
+  std::array<ObisCode, N> codes;
+
+public:
+  template <typename... Codes>
+  constexpr SmlObisSet(const Codes... t_codes) : codes{t_codes...} {
+    for (size_t i = 1; i < N; ++i) {
+      const ObisCode code = codes[i];
+      size_t j = i;
+      while (j > 0 && codes[j - 1].packed > code.packed) {
+        codes[j] = codes[j - 1];
+        --j;
+      }
+      codes[j] = code;
+    }
+  }
+
+  constexpr size_t size() const { return N; }
+
+  constexpr bool contains(const ObisCode code) const {
+    return SmlObisFilter(codes.data(), N).contains(code);
+  }
+
+  constexpr operator SmlObisFilter() const {
+    return SmlObisFilter(codes.data(), N);
+  }
+};
+
+template <typename... Codes>
+SmlObisSet(Codes...) -> SmlObisSet<sizeof...(Codes)>;
+
+#endif // SML_OBIS_SET_HPP
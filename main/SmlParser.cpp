@@ -1,5 +1,6 @@
 #include "SmlParser.hpp"
 #include "SmlCrc.hpp"
+#include "SmlFrameSync.hpp"
 #include <iostream>
 #include <map>
 
@@ -8,225 +9,473 @@ static const std::map<uint8_t, std::string> SmlUnit = {
   {0x1e, "Wh"}
 };
 
-SmlParser::SmlParser(unsigned char *t_buffer, int t_buffer_size)
-    : buffer{t_buffer}, buffer_size{t_buffer_size}, position{0}
+/** @brief Reads the objName of a list entry without decoding the entry
+ *  @return the OBIS code, INVALID if the entry has no six byte objName
+ */
+static ObisCode peekListEntryObis(const unsigned char *buffer,
+                                  const size_t buffer_size,
+                                  const size_t position)
+{
+  // 0x77 followed by the TL byte of a six byte octet string
+  if (position + 8 > buffer_size || buffer[position] != 0x77 ||
+      buffer[position + 1] != 0x07)
+  {
+    return ObisCode{};
+  }
+  return ObisCode::fromBytes(&buffer[position + 2], 6);
+}
+
+SmlParser::SmlParser(unsigned char *t_buffer, size_t t_buffer_size,
+                     SmlArena *t_arena)
+    : buffer{t_buffer}, buffer_size{t_buffer_size}, position{0},
+      arena{t_arena},
+      resource{t_arena != nullptr ? t_arena->getResource()
+                                  : std::pmr::get_default_resource()},
+      smlGetListRes{resource}
 {
   lexer = SmlLexer();
 }
 
+void SmlParser::beginFrame()
+{
+  obisIndex.clear();
+  if (arena == nullptr)
+  {
+    // keep the capacity of valList, the next frame has the same shape
+    smlGetListRes.clear();
+    return;
+  }
+
+  // nothing may point into the arena when it is reset
+  smlGetListRes = SmlGetListRes(resource);
+  arena->reset();
+}
+
 SmlParser::~SmlParser() { buffer = nullptr; }
 
-sml_error_t SmlParser::parseSml()
+sml_error_t SmlParser::parseSml() { return parseFrameAt(0); }
+
+sml_error_t SmlParser::parseNext()
 {
-  bool finished = false;
+  size_t start = findNextFrame();
+  if (start == SML_NPOS)
+  {
+    return SML_END_OF_DATA;
+  }
+  return parseFrameAt(start);
+}
 
-  if (buffer_size == 0 || buffer == nullptr)
+bool SmlParser::hasNext() const
+{
+  return buffer != nullptr && nextFrame < buffer_size &&
+         sml_find_start_sequence(buffer, buffer_size, nextFrame) != SML_NPOS;
+}
+
+size_t SmlParser::findNextFrame()
+{
+  if (buffer == nullptr || nextFrame >= buffer_size)
   {
-    SmlLogger::Error("Buffer is empty. Nothing to parse.");
-    return SML_ERROR_ZEROLENGTH;
+    return SML_NPOS;
   }
 
-  char pattern[] = {0x1b, 0x1b, 0x1b, 0x1b, 0x01, 0x01, 0x01, 0x01};
+  size_t start = sml_find_start_sequence(buffer, buffer_size, nextFrame);
+  if (start == SML_NPOS)
+  {
+    nextFrame = buffer_size;
+  }
+  return start;
+}
+
+void SmlParser::rewind() { nextFrame = 0; }
+
+void SmlParser::setBuffer(const unsigned char *t_buffer,
+                          const size_t t_buffer_size)
+{
+  buffer = t_buffer;
+  buffer_size = t_buffer_size;
   position = 0;
-  
-  while (memcmp(&buffer[position], &pattern, sizeof(pattern)) != 0)
+  frameStart = 0;
+  nextFrame = 0;
+}
+
+size_t SmlParser::getFrameOffset() const { return frameStart; }
+
+const SmlTime &SmlParser::getSensorTime() const
+{
+  return smlGetListRes.actSensorTime;
+}
+
+sml_error_t SmlParser::parseFrameAt(const size_t from)
+{
+  SmlCrc16 frameCrc;
+  sml_error_t result = parseFrameStart(frameCrc, from);
+  if (result != SML_OK)
+  {
+    return endFrame(result);
+  }
+  beginFrame();
+
+  while (position < buffer_size)
   {
-    position++;
-    if (position >= (buffer_size - sizeof(pattern)))
+    uint16_t messageType = 0;
+    result =
+        parseSmlMessage(buffer, buffer_size, position, messageType, &frameCrc);
+    if (result != SML_OK)
+    {
+      return endFrame(result);
+    }
+
+    if (messageType == SML_MSG_TYPE_PUBCLOS_RES)
     {
-      SmlLogger::Error("Unable to find start sequence in %d.",__LINE__);
-      hexPrint(buffer, position);
-      return SML_ERROR_SIZE;
+      return endFrame(
+          parseEndOfFrame(buffer, buffer_size, position, frameCrc));
     }
   }
-  SmlLogger::Verbose("Starting to parse on position %d", position);
+
+  SmlLogger::Error("Frame ends before PublicClose.Res in %d.", __LINE__);
+  return endFrame(SML_ERROR_SIZE);
+}
+
+sml_error_t SmlParser::endFrame(const sml_error_t result)
+{
+  // after an error, resync right behind the broken frame's start sequence
+  if (result == SML_OK)
+  {
+    nextFrame = position;
+  }
+  else
+  {
+    nextFrame = frameStart < buffer_size ? frameStart + 1 : buffer_size;
+  }
+  return result;
+}
+
+sml_error_t SmlParser::parseFrameStart(SmlCrc16 &frameCrc, const size_t from)
+{
+  if (buffer_size == 0 || buffer == nullptr)
+  {
+    SmlLogger::Error("Buffer is empty. Nothing to parse.");
+    return SML_ERROR_ZEROLENGTH;
+  }
+
+  position = sml_find_start_sequence(buffer, buffer_size, from);
+  if (position == SML_NPOS)
+  {
+    SmlLogger::Error("Unable to find start sequence in %d.", __LINE__);
+    position = 0;
+    frameStart = buffer_size;
+    return SML_ERROR_SIZE;
+  }
+  frameStart = position;
+  SmlLogger::Verbose("Starting to parse on position %zu", position);
+
+  // transport CRC over the whole frame, updated while walking the messages
+  frameCrc.init();
+  frameCrc.update(&buffer[position], SML_START_SEQUENCE_LENGTH);
+  paddingCount = 0;
 
   auto retval = parseEscapeSequence(buffer, buffer_size, position);
   if (retval != SML_OK)
   {
     SmlLogger::Error("Syntax error in %d. Expected start sequence 0x1b.",
                      __LINE__);
-    hexPrint(buffer, position);
+    hexPrint(buffer, buffer_size, position);
     return SML_ERROR_SYNTAX;
   }
 
   auto stop = position + 4;
-  for(int i = position; i < stop; ++i) 
+  for(size_t i = position; i < stop; ++i) 
   {
     if (buffer[position] != 0x01)
     {
       SmlLogger::Error("Syntax error in %d. Expected start sequence 0x01.",
                        __LINE__);
-      hexPrint(buffer, position);
+      hexPrint(buffer, buffer_size, position);
       return SML_ERROR_SYNTAX;
     }
     ++position;
   }
 
-  while (position < buffer_size)
+  return SML_OK;
+}
+
+sml_error_t SmlParser::parseEndOfFrame(const unsigned char *buffer,
+                                       const size_t buffer_size,
+                                       size_t &position,
+                                       SmlCrc16 &frameCrc)
+{
+  size_t trailerStart = position;
+
+  // messages are padded with 0x00 to a multiple of 4 bytes
+  while (position < buffer_size && buffer[position] == 0x00)
+  {
+    ++position;
+  }
+  size_t padding = position - trailerStart;
+
+  if (position + SML_END_SEQUENCE_LENGTH > buffer_size)
+  {
+    SmlLogger::Error("End sequence incomplete in %d.", __LINE__);
+    return SML_ERROR_SIZE;
+  }
+
+  if (parseEscapeSequence(buffer, buffer_size, position) != SML_OK)
   {
-    if (buffer[position] != 0x76)
+    SmlLogger::Error("Syntax error in %d. Expected escape sequence 0x1b.",
+                     __LINE__);
+    if (abortOnError == 0xFF)
     {
-      SmlLogger::Error("Syntax error in %d. Expected a list of 6.", __LINE__);
-      hexPrint(buffer, position);
+      hexPrint(buffer, buffer_size, position);
       return SML_ERROR_SYNTAX;
     }
+  }
 
-    int start_crc = position;
-  
-    SmlLogger::Info("<<<<< New SML Message >>>>>");
-    // transactionId
-    position++;
-    if (lexer.isOctetString(buffer[position]) == false)
+  if (buffer[position] != 0x1a)
+  {
+    SmlLogger::Error("Syntax error in %d. Expected end sequence 0x1a.",
+                     __LINE__);
+    if (abortOnError == 0xFF)
     {
-      SmlLogger::Error("Syntax error in %d. Expected octet string.", __LINE__);
-      hexPrint(buffer, position);
+      hexPrint(buffer, buffer_size, position);
       return SML_ERROR_SYNTAX;
     }
+  }
+  ++position;
 
-    int transactionIdLength = lexer.getOctetStringLength(buffer[position]);
-    std::string transactionId = lexer.getOctetString(
-        buffer, buffer_size, ++position, transactionIdLength);
-    if (transactionId.empty())
-    {
-      SmlLogger::Warning("Error parsing transactionId");
-      hexPrint(buffer, position);
-    }
+  paddingCount = buffer[position];
+  ++position;
+  if (paddingCount != padding)
+  {
+    SmlLogger::Warning("Padding count is %d, but found %zu padding bytes",
+                       paddingCount, padding);
+  }
 
-    position += transactionIdLength;
-    SmlLogger::Debug("transactionId: %02x\n", transactionId.c_str());
+  frameCrc.update(&buffer[trailerStart],
+                  static_cast<size_t>(position - trailerStart));
+  uint16_t computedCrc = frameCrc.final();
+  uint16_t crc16 = static_cast<uint16_t>((buffer[position] << 8) |
+                                         buffer[position + 1]);
+  position += 2;
 
-    // group ID
-    if (lexer.isUnsigned8(buffer[position] == false))
+  if (crc16 != computedCrc)
+  {
+    SmlLogger::Error("Transport CRC error: Should be %04x, but is %04x", crc16,
+                     computedCrc);
+    return SML_ERROR_CRC;
+  }
+
+  return SML_OK;
+}
+
+sml_error_t SmlParser::parseSmlMessage(const unsigned char *buffer,
+                                       const size_t buffer_size,
+                                       size_t &position,
+                                       uint16_t &messageType,
+                                       SmlCrc16 *frameCrc)
+{
+  const size_t start = position;
+  sml_error_t result =
+      parseSmlMessageHead(buffer, buffer_size, position, messageType);
+  if (result != SML_OK)
+  {
+    return result;
+  }
+
+  switch (messageType)
+  {
+  case SML_MSG_TYPE_PUBOPEN_RES:
+    smlPubOpenRes = parseSmlPublicOpenRes(buffer, buffer_size, position);
+    break;
+  case SML_MSG_TYPE_GETLIST_RES:
+    parseSmlGetListRes(buffer, buffer_size, position, smlGetListRes);
+    break;
+  case SML_MSG_TYPE_PUBCLOS_RES:
+    smlPubCloseRes = parseSmlPublicCloseRes(buffer, buffer_size, position);
+    break;
+  default:
+    result = skipSmlMessageBody(buffer, buffer_size, position, messageType);
+    if (result != SML_OK)
     {
-      SmlLogger::Error("Syntax error in %d. Expected Unsigned8.", __LINE__);
-      hexPrint(buffer, position);
-      return SML_ERROR_SYNTAX;
+      return result;
     }
+    break;
+  }
+
+  return parseSmlMessageTail(buffer, buffer_size, position, start, frameCrc);
+}
+
+sml_error_t SmlParser::parseSmlMessageHead(const unsigned char *buffer,
+                                           const size_t buffer_size,
+                                           size_t &position,
+                                           uint16_t &messageType)
+{
+  if (buffer[position] != 0x76)
+  {
+    SmlLogger::Error("Syntax error in %d. Expected a list of 6.", __LINE__);
+    hexPrint(buffer, buffer_size, position);
+    return SML_ERROR_SYNTAX;
+  }
 
-    uint8_t groupNo = lexer.getUnsigned8(buffer, buffer_size, position);
-    SmlLogger::Debug("group id: %d", groupNo);
+  SmlLogger::Info("<<<<< New SML Message >>>>>");
+  // transactionId
+  position++;
+  if (lexer.isOctetString(buffer[position]) == false)
+  {
+    SmlLogger::Error("Syntax error in %d. Expected octet string.", __LINE__);
+    hexPrint(buffer, buffer_size, position);
+    return SML_ERROR_SYNTAX;
+  }
+
+  int transactionIdLength = lexer.getOctetStringLength(buffer[position]);
+  SmlBytesView transactionId = lexer.getOctetString(
+      buffer, buffer_size, ++position, transactionIdLength);
+  if (transactionId.empty())
+  {
+    SmlLogger::Warning("Error parsing transactionId");
+    hexPrint(buffer, buffer_size, position);
+  }
+
+  position += transactionIdLength;
+  SmlLogger::Debug("transactionId: ", transactionId);
+
+  // group ID
+  if (lexer.isUnsigned8(buffer[position] == false))
+  {
+    SmlLogger::Error("Syntax error in %d. Expected Unsigned8.", __LINE__);
+    hexPrint(buffer, buffer_size, position);
+    return SML_ERROR_SYNTAX;
+  }
+
+  uint8_t groupNo = lexer.getUnsigned8(buffer, buffer_size, position);
+  SmlLogger::Debug("group id: %d", groupNo);
+
+  // abortOnError
+  if (lexer.isUnsigned8(buffer[position] == false))
+  {
+    SmlLogger::Error("Syntax error. Expected Unsigned8.");
+    hexPrint(buffer, buffer_size, position);
+    return SML_ERROR_SYNTAX;
+  }
+
+  abortOnError = lexer.getUnsigned8(buffer, buffer_size, position);
+  SmlLogger::Debug("abortOnError id: %d\n", abortOnError);
 
-    // abortOnError
-    if (lexer.isUnsigned8(buffer[position] == false))
+  // message body
+  uint8_t msgBodyElements = lexer.getSmlListLength(buffer, position);
+  if (msgBodyElements != 2)
+  {
+    SmlLogger::Warning("Syntax error. Expected SML message Type and Body");
+    if (abortOnError == 0xFF)
     {
-      SmlLogger::Error("Syntax error. Expected Unsigned8.");
-      hexPrint(buffer, position);
+      hexPrint(buffer, buffer_size, position);
       return SML_ERROR_SYNTAX;
     }
+  }
+  position++;
 
-    [[maybe_unused]] uint8_t abortOnError =
-        lexer.getUnsigned8(buffer, buffer_size, position);
-    SmlLogger::Debug("abortOnError id: %d\n", abortOnError);
+  // message body type
+  messageType = lexer.getUnsigned16(buffer, buffer_size, position);
+  SmlLogger::Debug("Type of SML message is %04x", messageType);
 
-    // message body
-    uint8_t msgBodyElements = lexer.getSmlListLength(buffer, position);
-    if (msgBodyElements != 2)
-    {
-      SmlLogger::Warning("Syntax error. Expected SML message Type and Body");
-      if (abortOnError == 0xFF)
-      {
-        hexPrint(buffer, position);
-        return SML_ERROR_SYNTAX;
-      }
-    }
-    position++;
+  return SML_OK;
+}
 
-    // message body type
-    uint16_t messageType = lexer.getUnsigned16(buffer, buffer_size, position);
-    SmlLogger::Debug("Type of SML message is %04x", messageType);
+sml_error_t SmlParser::skipSmlMessageBody(const unsigned char *buffer,
+                                          const size_t buffer_size,
+                                          size_t &position,
+                                          const uint16_t messageType)
+{
+  // the CRC check in parseSmlMessageTail still covers the skipped bytes
+  if (!lexer.skipElement(buffer, buffer_size, position))
+  {
+    SmlLogger::Error("Syntax error. Unable to skip SML message of type %04x",
+                     messageType);
+    hexPrint(buffer, buffer_size, position);
+    return SML_ERROR_SYNTAX;
+  }
 
-    switch (messageType)
-    {
-    case SML_MSG_TYPE_PUBOPEN_RES:
-      smlPubOpenRes = parseSmlPublicOpenRes(buffer, buffer_size, position);
-      break;
-    case SML_MSG_TYPE_GETLIST_RES:
-      smlGetListRes = parseSmlGetListRes(buffer, buffer_size, position);
-      break;
-    case SML_MSG_TYPE_PUBCLOS_RES:
-      smlPubCloseRes = parseSmlPublicCloseRes(buffer, buffer_size, position);
-      finished = true;
-      break;
-    default:
-      hexPrint(buffer, position);
-      SmlLogger::Error("Unknown SML message type");
-      return SML_UNKNOWN_TYPE;
-      break;
-    }
-    int end_crc = position;
-    
-    uint16_t crc16 = lexer.getUnsigned16(buffer, buffer_size, position);
-    if (crc16 !=
-        sml_crc16(const_cast<unsigned char *>(&buffer[start_crc]), end_crc - start_crc))
-    {
-      SmlLogger::Error(
-          "CRC error: Should be %04x, but is %04x", crc16,
-          sml_crc16(const_cast<unsigned char *>(buffer), end_crc - start_crc));
-          hexPrint(buffer, position);
-          return SML_ERROR_SYNTAX;
-    }
+  SmlLogger::Info("Skipped SML message of unknown type %04x", messageType);
+  return SML_OK;
+}
 
-    if (buffer[position] != 0x00)
-    {
-      SmlLogger::Error("Expected EndOfMessage, but found %02x",
-                       buffer[position]);
-      if (abortOnError == 0xFF)
-      {
-        hexPrint(buffer, position);
-        return SML_ERROR_SYNTAX;
-      }
-    }
-    else
-    {
-      SmlLogger::Info("---------- EoM ----------\n");
-    }
+sml_error_t SmlParser::parseSmlMessageTail(const unsigned char *buffer,
+                                           const size_t buffer_size,
+                                           size_t &position,
+                                           const size_t start_crc,
+                                           SmlCrc16 *frameCrc)
+{
+  size_t end_crc = position;
 
-    ++position;
+  // a corrupted length may have moved the position past the end
+  if (end_crc >= buffer_size)
+  {
+    SmlLogger::Error("Message exceeds the buffer in %d.", __LINE__);
+    return SML_ERROR_SIZE;
+  }
 
-    if (finished)
-    {
-      if (parseEscapeSequence(buffer, buffer_size, position) != SML_OK)
-      {
-        SmlLogger::Error("Syntax error in %d. Expected escape sequence 0x1b.",
-                         __LINE__);
-        if (abortOnError == 0xFF)
-        {
-          hexPrint(buffer, position);
-          return SML_ERROR_SYNTAX;
-        }
-      }
+  SmlCrc16 crc;
+  if (frameCrc != nullptr)
+  {
+    crc.update(&buffer[start_crc], static_cast<size_t>(end_crc - start_crc),
+               *frameCrc);
+  }
+  else
+  {
+    crc.update(&buffer[start_crc], static_cast<size_t>(end_crc - start_crc));
+  }
+  uint16_t computedCrc = crc.final();
 
-      if (buffer[position] != 0x1a)
-      {
-        SmlLogger::Error("Syntax error in %d. Expected end sequence 0x1a.",
-                         __LINE__);
-        ++position;
-        if (abortOnError == 0xFF)
-        {
-          hexPrint(buffer, position);
-          return SML_ERROR_SYNTAX;
-        }
-      }
-      // delete smlMessage;
-      break;
+  uint16_t crc16 = lexer.getUnsigned16(buffer, buffer_size, position);
+  if (crc16 != computedCrc)
+  {
+    SmlLogger::Error("CRC error: Should be %04x, but is %04x", crc16,
+                     computedCrc);
+    hexPrint(buffer, buffer_size, position);
+    return SML_ERROR_CRC;
+  }
+
+  if (position >= buffer_size)
+  {
+    SmlLogger::Error("EndOfMessage missing in %d.", __LINE__);
+    return SML_ERROR_SIZE;
+  }
+
+  if (buffer[position] != 0x00)
+  {
+    SmlLogger::Error("Expected EndOfMessage, but found %02x",
+                     buffer[position]);
+    if (abortOnError == 0xFF)
+    {
+      hexPrint(buffer, buffer_size, position);
+      return SML_ERROR_SYNTAX;
     }
   }
+  else
+  {
+    SmlLogger::Info("---------- EoM ----------\n");
+  }
+
+  ++position;
+
+  if (frameCrc != nullptr)
+  {
+    frameCrc->update(&buffer[end_crc], static_cast<size_t>(position - end_crc));
+  }
 
   return SML_OK;
 }
 
 sml_error_t SmlParser::parseEscapeSequence(const unsigned char *buffer,
-                                           const int buffer_size,
-                                           int &position)
+                                           const size_t buffer_size,
+                                           size_t &position)
 {
-  if (position > buffer_size - 4)
+  if (position + 4 > buffer_size)
   {
     return SML_ERROR_SIZE;
   }
   
-  int stop = position+4;
-  for (int i = position; i < stop; ++i)
+  size_t stop = position+4;
+  for (size_t i = position; i < stop; ++i)
   {
     if (buffer[i] != 0x1b)
     {
@@ -239,8 +488,8 @@ sml_error_t SmlParser::parseEscapeSequence(const unsigned char *buffer,
 }
 
 SmlPublicOpenRes SmlParser::parseSmlPublicOpenRes(const unsigned char *buffer,
-                                                  const int buffer_size,
-                                                  int &position)
+                                                  const size_t buffer_size,
+                                                  size_t &position)
 {
 
   if (lexer.getSmlListLength(buffer, position) != 6)
@@ -256,9 +505,9 @@ SmlPublicOpenRes SmlParser::parseSmlPublicOpenRes(const unsigned char *buffer,
   ++position;
   if (codePageLength > 0)
   {
-    std::string codePage =
+    SmlBytesView codePage =
         lexer.getOctetString(buffer, buffer_size, position, codePageLength);
-    SmlLogger::Info("codePage: %s", codePage.c_str());
+    SmlLogger::Info("codePage: ", codePage);
 
     ret.codePage = codePage;
   }
@@ -269,9 +518,9 @@ SmlPublicOpenRes SmlParser::parseSmlPublicOpenRes(const unsigned char *buffer,
   ++position;
   if (clientIdLength > 0)
   {
-    std::string clientId =
+    SmlBytesView clientId =
         lexer.getOctetString(buffer, buffer_size, position, clientIdLength);
-    SmlLogger::Info("clientId: %s", clientId.c_str());
+    SmlLogger::Info("clientId: ", clientId);
 
     ret.clientId = clientId;
   }
@@ -285,9 +534,9 @@ SmlPublicOpenRes SmlParser::parseSmlPublicOpenRes(const unsigned char *buffer,
     SmlLogger::Warning(
         "Syntax error in line %d. Required element reqField missing", __LINE__);
   }
-  std::string reqField =
+  SmlBytesView reqField =
       lexer.getOctetString(buffer, buffer_size, position, reqFieldLength);
-  SmlLogger::Info("reqField: %s", reqField.c_str());
+  SmlLogger::Info("reqField: ", reqField);
   ret.reqField = reqField;
   position += reqFieldLength;
 
@@ -299,9 +548,9 @@ SmlPublicOpenRes SmlParser::parseSmlPublicOpenRes(const unsigned char *buffer,
     SmlLogger::Warning(
         "Sytax error in line %d. Required element serverId missing", __LINE__);
   }
-  std::string serverId =
+  SmlBytesView serverId =
       lexer.getOctetString(buffer, buffer_size, position, serverIdLength);
-  SmlLogger::Info("serverID: %s", serverId.c_str());
+  SmlLogger::Info("serverID: ", serverId);
   ret.serverId = serverId;
   ++position;
   position += serverIdLength;
@@ -331,8 +580,8 @@ SmlPublicOpenRes SmlParser::parseSmlPublicOpenRes(const unsigned char *buffer,
 }
 
 SmlPublicCloseRes SmlParser::parseSmlPublicCloseRes(const unsigned char *buffer,
-                                                    const int buffer_size,
-                                                    int &position)
+                                                    const size_t buffer_size,
+                                                    size_t &position)
 {
 
   if (lexer.getSmlListLength(buffer, position) != 1)
@@ -349,10 +598,10 @@ SmlPublicCloseRes SmlParser::parseSmlPublicCloseRes(const unsigned char *buffer,
     ++position;
     if (globalSignatureLength > 0)
     {
-      std::string globalSignature = lexer.getOctetString(
+      SmlBytesView globalSignature = lexer.getOctetString(
           buffer, buffer_size, position, globalSignatureLength);
       ret.globalSignature = globalSignature;
-      SmlLogger::Info("globalSignature %s", globalSignature.c_str());
+      SmlLogger::Info("globalSignature ", globalSignature);
     }
     else
     {
@@ -366,11 +615,11 @@ SmlPublicCloseRes SmlParser::parseSmlPublicCloseRes(const unsigned char *buffer,
         lexer.getExtendedOctetStringLength(buffer, buffer_size, position);
     if (globalSignatureLength > 0)
     {
-      std::string globalSignature = lexer.getExtendedOctetString(
+      SmlBytesView globalSignature = lexer.getExtendedOctetString(
           buffer, buffer_size, position, globalSignatureLength);
       ret.globalSignature = globalSignature;
 
-      SmlLogger::Info("globalSignature %s", globalSignature.c_str());
+      SmlLogger::Info("globalSignature ", globalSignature);
     }
     else
     {
@@ -385,8 +634,59 @@ SmlPublicCloseRes SmlParser::parseSmlPublicCloseRes(const unsigned char *buffer,
 }
 
 SmlGetListRes SmlParser::parseSmlGetListRes(const unsigned char *buffer,
-                                            const int buffer_size,
-                                            int &position)
+                                            const size_t buffer_size,
+                                            size_t &position)
+{
+  SmlGetListRes ret{resource};
+  parseSmlGetListRes(buffer, buffer_size, position, ret);
+  return ret;
+}
+
+void SmlParser::parseSmlGetListRes(const unsigned char *buffer,
+                                   const size_t buffer_size, size_t &position,
+                                   SmlGetListRes &ret)
+{
+  int valListLength =
+      parseSmlGetListResHead(buffer, buffer_size, position, ret);
+
+  // one allocation per list, a growing vector would leave its old blocks
+  // unused in the arena until the next frame. Without an arena the capacity
+  // is kept across frames, so this only allocates if the list got longer.
+  if (valListLength != 0xFF)
+  {
+    ret.valList.reserve(valListLength);
+  }
+  obisIndex.clear();
+  for (int i = 0; i < valListLength; i++)
+  {
+    if (skipUnwantedListEntry(buffer, buffer_size, position))
+    {
+      continue;
+    }
+
+    ret.valList.emplace_back(parseSmlListEntry(buffer, buffer_size, position));
+    obisIndex.insert(ret.valList.back().obis(),
+                     static_cast<uint16_t>(ret.valList.size() - 1));
+    SmlLogger::Verbose("List size: %d", (int)ret.valList.size());
+  }
+
+  parseSmlGetListResTail(buffer, buffer_size, position, ret);
+}
+
+bool SmlParser::skipUnwantedListEntry(const unsigned char *buffer,
+                                      const size_t buffer_size,
+                                      size_t &position)
+{
+  return obisFilter.isActive() &&
+         !obisFilter.contains(
+             peekListEntryObis(buffer, buffer_size, position)) &&
+         lexer.skipElement(buffer, buffer_size, position);
+}
+
+int SmlParser::parseSmlGetListResHead(const unsigned char *buffer,
+                                      const size_t buffer_size,
+                                      size_t &position,
+                                      SmlGetListRes &ret)
 {
 
   if (lexer.getSmlListLength(buffer, position) != 7)
@@ -395,16 +695,16 @@ SmlGetListRes SmlParser::parseSmlGetListRes(const unsigned char *buffer,
   }
   position++;
 
-  SmlGetListRes ret;
+  ret.clear();
   // clientId
   int clientIdLength = lexer.getOctetStringLength(buffer[position]);
   ++position;
   if (clientIdLength > 0)
   {
-    std::string clientId =
+    SmlBytesView clientId =
         lexer.getOctetString(buffer, buffer_size, position, clientIdLength);
     ret.clientId = clientId;
-    SmlLogger::Info("clientId: %s", clientId.c_str());
+    SmlLogger::Info("clientId: ", clientId);
   }
   else
   {
@@ -420,10 +720,10 @@ SmlGetListRes SmlParser::parseSmlGetListRes(const unsigned char *buffer,
     SmlLogger::Warning(
         "Syntax error in line %d. Required element serverId missing", __LINE__);
   }
-  std::string serverId =
+  SmlBytesView serverId =
       lexer.getOctetString(buffer, buffer_size, position, serverIdLength);
   ret.serverId = serverId;
-  SmlLogger::Info("serverId:, %s", serverId.c_str());
+  SmlLogger::Info("serverId: ", serverId);
   position += serverIdLength;
 
   // listName
@@ -431,10 +731,10 @@ SmlGetListRes SmlParser::parseSmlGetListRes(const unsigned char *buffer,
   ++position;
   if (listNameLength > 0)
   {
-    std::string listName =
+    SmlBytesView listName =
         lexer.getOctetString(buffer, buffer_size, position, listNameLength);
     ret.listName = listName;
-    SmlLogger::Info("listName: %s", listName.c_str());
+    SmlLogger::Info("listName: ", listName);
   }
   else
   {
@@ -454,21 +754,23 @@ SmlGetListRes SmlParser::parseSmlGetListRes(const unsigned char *buffer,
   ++position;
   SmlLogger::Info("Found %d valList entries", valListLength);
 
-  for (int i = 0; i < valListLength; i++)
-  {
-    ret.valList.emplace_back(parseSmlListEntry(buffer, buffer_size, position));
-    SmlLogger::Verbose("List size: %d", (int)ret.valList.size());
-  }
+  return valListLength;
+}
 
+void SmlParser::parseSmlGetListResTail(const unsigned char *buffer,
+                                       const size_t buffer_size,
+                                       size_t &position,
+                                       SmlGetListRes &ret)
+{
   // listSignature
   int listSignatureLength = lexer.getOctetStringLength(buffer[position]);
   ++position;
   if (listSignatureLength > 0)
   {
-    std::string listSignature = lexer.getOctetString(
+    SmlBytesView listSignature = lexer.getOctetString(
         buffer, buffer_size, position, listSignatureLength);
     ret.listSignature = listSignature;
-    SmlLogger::Info("listSignature: %s", listSignature.c_str());
+    SmlLogger::Info("listSignature: ", listSignature);
   }
   else
   {
@@ -487,14 +789,21 @@ SmlGetListRes SmlParser::parseSmlGetListRes(const unsigned char *buffer,
     SmlLogger::Info("No actGatewaytime");
     ++position;
   }
-
-  return ret;
 }
 
 SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
-                                          const int buffer_size,
-                                          int &position)
+                                          const size_t buffer_size,
+                                          size_t &position)
 {
+  // the fields trust their TL bytes, so the entry as a whole must fit
+  size_t entryEnd = position;
+  if (!lexer.skipElement(buffer, buffer_size, entryEnd))
+  {
+    SmlLogger::Warning("Syntax error in line %d: List entry exceeds the buffer",
+                       __LINE__);
+    return SmlListEntry{};
+  }
+
   if (buffer[position] != 0x77)
   {
     SmlLogger::Warning("Syntax error in line %d: Expected a list of 7 entries, "
@@ -509,51 +818,48 @@ SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
   ++position;
   if (nameLength > 0)
   {
-    std::string name =
+    SmlBytesView name =
         lexer.getOctetString(buffer, buffer_size, position, nameLength);
 
-    if (name == OBIS_MANUFACTURER)
+    if (!ret.setObjName(name))
     {
-      SmlLogger::Info("Manufacturer: ", name);
+      SmlLogger::Warning("objName is not a six byte OBIS code");
     }
-    else if (name == OBIS_DEVICE_ID)
+    switch (ret.obis().packed)
     {
+    case OBIS_MANUFACTURER.packed:
+      SmlLogger::Info("Manufacturer: ", name);
+      break;
+    case OBIS_DEVICE_ID.packed:
       SmlLogger::Info("Device ID: ", name);
+      break;
+    case OBIS_TOTAL_ENERGY.packed:
+      SmlLogger::Info("Zählerstand Total: ", name);
+      break;
+    case OBIS_ENERGY_T1.packed:
+      SmlLogger::Info("Zählerstand Tarif 1: ", name);
+      break;
+    case OBIS_ENERGY_T2.packed:
+      SmlLogger::Info("Zählerstand Tarif 2: ", name);
+      break;
+    case OBIS_PUB_KEY.packed:
+      SmlLogger::Info("Public Key: ", name);
+      break;
+    case OBIS_SUM_ACT_INST_PWR.packed:
+      SmlLogger::Info("Sum current active power: ", name);
+      break;
+    case OBIS_SUM_ACT_INST_PWR_L1.packed:
+      SmlLogger::Info("Current active power L1: ", name);
+      break;
+    case OBIS_SUM_ACT_INST_PWR_L2.packed:
+      SmlLogger::Info("Current active power L2: ", name);
+      break;
+    case OBIS_SUM_ACT_INST_PWR_L3.packed:
+      SmlLogger::Info("Current active power L3: ", name);
+      break;
+    default:
+      break;
     }
-    else if (name == OBIS_TOTAL_ENERGY)
-    {
-      SmlLogger::Info("Zählerstand Total: %02x", name.c_str());
-    }
-    else if (name == OBIS_ENERGY_T1)
-    {
-      SmlLogger::Info("Zählerstand Tarif 1: %s", name.c_str());
-    }
-    else if (name == OBIS_ENERGY_T2)
-    {
-      SmlLogger::Info("Zählerstand Tarif 2: %s", name.c_str());
-    }
-    else if (name == OBIS_PUB_KEY)
-    {
-      SmlLogger::Info("Public Key: %s", name.c_str());
-    }
-    else if (name == OBIS_SUM_ACT_INST_PWR)
-    {
-      SmlLogger::Info("Sum current active power: %s", name.c_str());
-    }
-    else if (name == OBIS_SUM_ACT_INST_PWR_L1)
-    {
-      SmlLogger::Info("Current active power L1: %s", name.c_str());
-    }
-    else if (name == OBIS_SUM_ACT_INST_PWR_L2)
-    {
-      SmlLogger::Info("Current active power L2: %s", name.c_str());
-    }
-    else if (name == OBIS_SUM_ACT_INST_PWR_L3)
-    {
-      SmlLogger::Info("Current active power L3: %s", name.c_str());
-    }
-
-    ret.objName = name;
   }
   else
   {
@@ -564,8 +870,8 @@ SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
   // status
   if (buffer[position] != 0x01)
   {
-    ret.status = lexer.getSmlStatus(buffer, buffer_size, position);
-    SmlLogger::Info("status: %ld", ret.status);
+    ret.setStatus(lexer.getSmlStatus(buffer, buffer_size, position));
+    SmlLogger::Info("status: %ld", ret.status());
   }
   else
   {
@@ -576,7 +882,25 @@ SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
   // valTime
   if (buffer[position] != 0x01)
   {
-    SmlLogger::Info("valTime: %05x", ret.valTime.timeValue);
+    // skip the whole element first, getSmlTime() stops early on a local
+    // timestamp or an invalid time type
+    size_t valTimeEnd = position;
+    if (!lexer.skipElement(buffer, buffer_size, valTimeEnd))
+    {
+      SmlLogger::Warning("Syntax error in line %d: Invalid valTime", __LINE__);
+      valTimeEnd = position + 1;
+    }
+    const SmlTime valTime = lexer.getSmlTime(buffer, buffer_size, position);
+    if (position == valTimeEnd)
+    {
+      ret.setValTime(valTime);
+      SmlLogger::Info("valTime: %05x", ret.valTime().timeValue);
+    }
+    else
+    {
+      SmlLogger::Warning("Ignored valTime of unsupported type");
+    }
+    position = valTimeEnd;
   }
   else
   {
@@ -587,8 +911,8 @@ SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
   // unit
   if (buffer[position] != 0x01)
   {
-    ret.unit = lexer.getUnsigned8(buffer, buffer_size, position);
-    SmlLogger::Info("unit: %02x", ret.unit);
+    ret.setUnit(lexer.getUnsigned8(buffer, buffer_size, position));
+    SmlLogger::Info("unit: %02x", ret.unit());
   }
   else
   {
@@ -599,8 +923,8 @@ SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
   // scaler
   if (buffer[position] != 0x01)
   {
-    ret.scaler = lexer.getInteger8(buffer, buffer_size, position);
-    SmlLogger::Info("scaler: %02d", ret.scaler);
+    ret.setScaler(lexer.getInteger8(buffer, buffer_size, position));
+    SmlLogger::Info("scaler: %02d", ret.scaler());
   }
   else
   {
@@ -618,11 +942,10 @@ SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
 
     if (valueLength > 0)
     {
-      std::string value =
+      SmlBytesView value =
           lexer.getOctetString(buffer, buffer_size, position, valueLength);
       SmlLogger::Info("value: ", value);
-      ret.isString = true;
-      ret.sValue = value;
+      ret.setBytes(value);
     }
     else
     {
@@ -636,10 +959,13 @@ SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
         lexer.getExtendedOctetStringLength(buffer, buffer_size, position);
     if (valueLength > 0)
     {
-      std::string value = lexer.getExtendedOctetString(buffer, buffer_size,
+      SmlBytesView value = lexer.getExtendedOctetString(buffer, buffer_size,
                                                        position, valueLength);
-      ret.isString = true;
-      ret.sValue = value;
+      if (!ret.setBytes(value))
+      {
+        SmlLogger::Warning("Dropped value of %zu bytes, too long",
+                           value.length);
+      }
       SmlLogger::Info("value ", value);
     }
     else
@@ -650,17 +976,15 @@ SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
 
     // currently only unsigned and signed values are supported
   }
-  else if ((buffer[position] & 0xF0) == 0x50)
+  else if (lexer.getTlInfo(buffer[position]).type == SmlTlType::Integer)
   {
-    ret.isString = false;
-    ret.iValue = uint64_t(lexer.getInteger(buffer, buffer_size, position));
-    SmlLogger::Info("value: %ld", ret.iValue);
+    ret.setInteger(lexer.getInteger(buffer, buffer_size, position));
+    SmlLogger::Info("value: %ld", ret.iValue());
   }
-  else if ((buffer[position] & 0xF0) == 0x60)
+  else if (lexer.getTlInfo(buffer[position]).type == SmlTlType::Unsigned)
   {
-    ret.isString = false;
-    ret.iValue = lexer.getUnsigned(buffer, buffer_size, position);
-    SmlLogger::Info("value: %ld", ret.iValue);
+    ret.setUnsigned(lexer.getUnsigned(buffer, buffer_size, position));
+    SmlLogger::Info("value: %ld", ret.iValue());
   }
 
   // valueSignature
@@ -670,10 +994,10 @@ SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
     ++position;
     if (valueSignatureLength > 0)
     {
-      std::string valueSignature = lexer.getOctetString(
+      SmlBytesView valueSignature = lexer.getOctetString(
           buffer, buffer_size, position, valueSignatureLength);
-      ret.signature = valueSignature;
-      SmlLogger::Info("valueSignature %s", valueSignature.c_str());
+      ret.setSignature(valueSignature);
+      SmlLogger::Info("valueSignature ", valueSignature);
     }
     else
     {
@@ -687,10 +1011,14 @@ SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
         lexer.getExtendedOctetStringLength(buffer, buffer_size, position);
     if (valueSignatureLength > 0)
     {
-      std::string valueSignature = lexer.getExtendedOctetString(
+      SmlBytesView valueSignature = lexer.getExtendedOctetString(
           buffer, buffer_size, position, valueSignatureLength);
-      ret.signature = valueSignature;
-      SmlLogger::Info("valueSignature %s", valueSignature.c_str());
+      if (!ret.setSignature(valueSignature))
+      {
+        SmlLogger::Warning("Dropped valueSignature of %zu bytes, too long",
+                           valueSignature.length);
+      }
+      SmlLogger::Info("valueSignature ", valueSignature);
     }
     else
     {
@@ -701,13 +1029,17 @@ SmlListEntry SmlParser::parseSmlListEntry(const unsigned char *buffer,
 
   SmlLogger::Debug("_____ End of List Entry _____\n");
 
+  position = entryEnd;
   return ret;
 }
 
-void SmlParser::hexPrint(const unsigned char *buffer, int &position)
+void SmlParser::hexPrint(const unsigned char *buffer, const size_t buffer_size,
+                         size_t &position)
 {
-  int start = 20;
-  for (int i = position - start; i < position + start; ++i)
+  size_t start = 20;
+  size_t first = position > start ? position - start : 0;
+  size_t last = std::min(position + start, buffer_size);
+  for (size_t i = first; i < last; ++i)
   {
     if (i == position)
     {
@@ -720,11 +1052,11 @@ void SmlParser::hexPrint(const unsigned char *buffer, int &position)
     }
   }
   printf("\n");
-  for (int i = position - start; i < position + start; ++i)
+  for (size_t i = first; i < last; ++i)
   {
     if (i == position)
     {
-      printf("%03d", position);
+      printf("%03zu", position);
     }
     else
     {
@@ -734,17 +1066,54 @@ void SmlParser::hexPrint(const unsigned char *buffer, int &position)
   printf("\n");
 }
 
-SmlListEntry SmlParser::getElementByObis(std::string obis)
+const SmlListEntry &SmlParser::getElementByObis(const ObisCode obis) const
 {
-  for (auto le : smlGetListRes.valList)
+  static const SmlListEntry notFound{};
+
+  int index = obisIndex.find(obis);
+  if (index >= 0)
   {
-    if (le.objName == obis)
+    return smlGetListRes.valList[index];
+  }
+
+  if (obisIndex.isIncomplete())
+  {
+    for (const SmlListEntry &le : smlGetListRes.valList)
     {
-      return le;
+      if (le.obis() == obis)
+      {
+        return le;
+      }
     }
   }
 
-  return SmlListEntry();
+  return notFound;
+}
+
+const SmlListEntry &SmlParser::getElementByObis(const std::string &obis) const
+{
+  return getElementByObis(ObisCode::fromBytes(obis));
+}
+
+size_t SmlParser::getElementsByObis(
+    std::span<const ObisCode> codes,
+    std::span<const SmlListEntry *> results) const
+{
+  size_t found = 0;
+  for (size_t i = 0; i < codes.size() && i < results.size(); ++i)
+  {
+    const SmlListEntry &le = getElementByObis(codes[i]);
+    if (le.objName().empty())
+    {
+      results[i] = nullptr;
+    }
+    else
+    {
+      results[i] = &le;
+      ++found;
+    }
+  }
+  return found;
 }
 
 std::string SmlParser::getUnitAsString(uint8_t unit) {
@@ -753,4 +1122,11 @@ std::string SmlParser::getUnitAsString(uint8_t unit) {
   } else {
     return SmlUnit.at(unit);
   }
-}
\ No newline at end of file
+}
+
+uint8_t SmlParser::getPaddingCount() const { return paddingCount; }
+
+void SmlParser::setObisFilter(const SmlObisFilter filter)
+{
+  obisFilter = filter;
+}
@@ -1,24 +1,90 @@
 #ifndef SML_PARSER_HPP
 #define SML_PARSER_HPP
 
+#include "SmlArena.hpp"
+#include "SmlCrc.hpp"
+#include "SmlFrameSync.hpp"
 #include "SmlLexer.hpp"
 #include "SmlLogger.hpp"
 #include "SmlMessageBody.hpp"
+#include "SmlObisIndex.hpp"
+#include "SmlObisSet.hpp"
 #include "SmlTypes.hpp"
 #include <cstring>
+#include <span>
+
+/** @brief Length of the SML end sequence 1b1b1b1b 1a, padding count, CRC16 */
+const int SML_END_SEQUENCE_LENGTH = 8;
+
+/** @brief No-op base for visitors passed to SmlParser::parseSml(Visitor &)
+ *
+ *  Derive from it and hide the callbacks you are interested in. The calls
+ *  are resolved at compile time, so unused callbacks cost nothing. Messages
+ *  are reported while they are decoded, i.e. before their CRC was checked;
+ *  a CRC or syntax error is reported through onError() afterwards.
+ */
+struct SmlVisitor {
+  void onOpenRes(const SmlPublicOpenRes &) {}
+  /** @brief GetList.Res head (serverId, actSensorTime, ...), valList is
+   *  empty, its entries follow through onListEntry() */
+  void onListStart(const SmlGetListRes &) {}
+  void onListEntry(const SmlListEntryView &) {}
+  void onCloseRes(const SmlPublicCloseRes &) {}
+  void onError(const sml_error_t) {}
+};
 
 class SmlParser {
 private:
   const unsigned char *buffer;
-  int buffer_size;
-  int position;
+  size_t buffer_size;
+  size_t position;
+  size_t frameStart{0};
+  size_t nextFrame{0};
+  uint8_t abortOnError{0};
+  uint8_t paddingCount{0};
   SmlLexer lexer;
+  SmlArena *arena;
+  std::pmr::memory_resource *resource;
   SmlPublicOpenRes smlPubOpenRes;
   SmlPublicCloseRes smlPubCloseRes;
   SmlGetListRes smlGetListRes;
+  SmlObisIndex obisIndex;
+  SmlObisFilter obisFilter;
+
+  sml_error_t parseFrameAt(const size_t from);
+  template <typename Visitor>
+  sml_error_t parseFrameAt(const size_t from, Visitor &visitor);
+  sml_error_t endFrame(const sml_error_t result);
+  size_t findNextFrame();
+  sml_error_t parseFrameStart(SmlCrc16 &frameCrc, const size_t from);
+  sml_error_t parseSmlMessageHead(const unsigned char *buffer,
+                                  const size_t buffer_size, size_t &position,
+                                  uint16_t &messageType);
+  sml_error_t skipSmlMessageBody(const unsigned char *buffer,
+                                 const size_t buffer_size, size_t &position,
+                                 const uint16_t messageType);
+  sml_error_t parseSmlMessageTail(const unsigned char *buffer,
+                                  const size_t buffer_size, size_t &position,
+                                  const size_t start_crc, SmlCrc16 *frameCrc);
+  int parseSmlGetListResHead(const unsigned char *buffer,
+                             const size_t buffer_size, size_t &position,
+                             SmlGetListRes &ret);
+  void parseSmlGetListResTail(const unsigned char *buffer,
+                              const size_t buffer_size, size_t &position,
+                              SmlGetListRes &ret);
+  bool skipUnwantedListEntry(const unsigned char *buffer,
+                             const size_t buffer_size, size_t &position);
 
 public:
-  SmlParser(unsigned char *t_buffer, int t_buffer_size);
+  /** @brief Creates a parser
+   *  @param t_buffer The buffer holding the SML frame
+   *  @param t_buffer_size Size of the buffer
+   *  @param t_arena If not NULL, all results of a frame are allocated from
+   *         this arena, which is reset at the start of every frame.
+   *         Otherwise the default memory resource (the heap) is used.
+   */
+  SmlParser(unsigned char *t_buffer, size_t t_buffer_size,
+            SmlArena *t_arena = nullptr);
   ~SmlParser();
 
   /** @brief Main parsing function
@@ -27,10 +93,134 @@ public:
    *  @return SML_OK on success
    *  @return SML_SML_ERROR_ZEROLENGTH if buffer is NULL or buffer_size is 0
    *  @return SML_ERROR_SYNTAX on syntax error
-   *  @return SML_UNKNOWN_TYPE if message type if unknown
+   *  @return SML_ERROR_SIZE if the frame is cut off
+   *  @return SML_ERROR_CRC if a message or the transport CRC does not match
+   *  Messages of unknown type are skipped by their TL fields, their CRC is
+   *  still checked.
    */
   sml_error_t parseSml(void);
 
+  /** @brief Parses a frame and reports its contents to a visitor
+   *
+   *  Nothing is stored in the parser, getElementByObis() does not see the
+   *  results of this call. The OBIS filter applies to onListEntry().
+   *  @param visitor Object with the callbacks of SmlVisitor
+   *  @return see parseSml(), errors are also passed to visitor.onError()
+   */
+  template <typename Visitor> sml_error_t parseSml(Visitor &visitor);
+
+  /** @brief Parses the next frame in the buffer
+   *
+   *  Continues behind the frame parsed by the previous parseSml() or
+   *  parseNext() call, so a buffer holding several frames is walked with
+   *  one parser and without scanning any byte twice:
+   *  while ((result = parser.parseNext()) != SML_END_OF_DATA) { ... }
+   *  After a broken frame the search resumes right behind its start.
+   *  @return SML_END_OF_DATA if there is no further start sequence
+   *  @return see parseSml() otherwise
+   */
+  sml_error_t parseNext();
+
+  /** @brief Parses the next frame and reports it to a visitor
+   *  @param visitor Object with the callbacks of SmlVisitor
+   *  @return see parseNext(), SML_END_OF_DATA is not passed to onError()
+   */
+  template <typename Visitor> sml_error_t parseNext(Visitor &visitor);
+
+  /** @brief Tells whether parseNext() would find another start sequence
+   *  @return true if there is a further frame in the buffer
+   */
+  bool hasNext() const;
+
+  /** @brief Lets the next parseNext() start at the beginning of the buffer */
+  void rewind();
+
+  /** @brief Points the parser to another buffer
+   *
+   *  Lets one parser, with its lexer, OBIS index and list capacity, walk
+   *  many buffers. The results of the previous frame stay valid until the
+   *  next frame is parsed.
+   *  @param t_buffer The buffer holding the SML frames
+   *  @param t_buffer_size Size of the buffer
+   */
+  void setBuffer(const unsigned char *t_buffer, const size_t t_buffer_size);
+
+  /** @brief Returns where the last parsed frame started
+   *  @return offset of its start sequence in the buffer
+   */
+  size_t getFrameOffset() const;
+
+  /** @brief Returns the actSensorTime of the last GetList.Res
+   *  @return the time, timeValue is 0 if the frame had none
+   */
+  const SmlTime &getSensorTime() const;
+
+  /** @brief Parses one SML message and reports it to a visitor
+   *  @param visitor Object with the callbacks of SmlVisitor
+   *  @see parseSmlMessage(const unsigned char *, const int, int &,
+   *       uint16_t &, SmlCrc16 *)
+   */
+  template <typename Visitor>
+  sml_error_t parseSmlMessage(const unsigned char *buffer,
+                              const size_t buffer_size, size_t &position,
+                              uint16_t &messageType, Visitor &visitor,
+                              SmlCrc16 *frameCrc = nullptr);
+
+  /** @brief Drops the results of the previous frame
+   *
+   *  Called by parseSml() and by SmlStreamParser when a start sequence was
+   *  found. Resets the arena, if any, so references to entries of the
+   *  previous frame become invalid.
+   */
+  void beginFrame();
+
+  /** @brief Parses one SML message including its CRC and EndOfSmlMsg
+   *  @param buffer The array of unsigned char to parse
+   *  @param buffer_size The size of the buffer
+   *  @param position Position of the message's list TL byte, advanced past
+   *         the EndOfSmlMsg byte
+   *  @param messageType Receives the type of the message body
+   *  @param frameCrc If not NULL, the message bytes are added to this
+   *         transport CRC in the same pass as the message CRC
+   *  @return SML_OK on success
+   *  @return SML_ERROR_SYNTAX on syntax error
+   *  @return SML_ERROR_CRC if the message CRC does not match
+   *  The body of a message of unknown type is skipped without decoding.
+   */
+  sml_error_t parseSmlMessage(const unsigned char *buffer,
+                              const size_t buffer_size, size_t &position,
+                              uint16_t &messageType,
+                              SmlCrc16 *frameCrc = nullptr);
+
+  /** @brief Parses padding and end sequence and checks the transport CRC
+   *  @param buffer The array of unsigned char to parse
+   *  @param buffer_size The size of the buffer
+   *  @param position Position after the last message, advanced past the CRC
+   *  @param frameCrc CRC over all frame bytes before position
+   *  @return SML_OK on success
+   *  @return SML_ERROR_SIZE if the end sequence is incomplete
+   *  @return SML_ERROR_SYNTAX on a malformed end sequence
+   *  @return SML_ERROR_CRC if the transport CRC does not match
+   */
+  sml_error_t parseEndOfFrame(const unsigned char *buffer,
+                              const size_t buffer_size, size_t &position,
+                              SmlCrc16 &frameCrc);
+
+  /** @brief Returns the padding count of the last end sequence
+   *  @return number of 0x00 bytes the sender appended to the messages
+   */
+  uint8_t getPaddingCount() const;
+
+  /** @brief Restricts GetList.Res entries to a set of OBIS codes
+   *
+   *  Entries whose OBIS code is not in the filter are skipped using only
+   *  their TL fields, they are neither decoded nor logged nor stored. The
+   *  message CRC still covers them. The codes have to outlive the parser,
+   *  e.g. a static constexpr SmlObisSet.
+   *  @param filter The wanted codes, a default SmlObisFilter keeps all
+   */
+  void setObisFilter(const SmlObisFilter filter);
+
   /**  @brief parses the SML escape sequence
    *  @param buffer The aray of unsigned char to parse
    *  @param buffer_size The site of the buffer to check
@@ -40,7 +230,7 @@ public:
    *  @return SML_ERROR_HEADER on a syntax error
    */
   sml_error_t parseEscapeSequence(const unsigned char *buffer,
-                                  const int buffer_size, int &position);
+                                  const size_t buffer_size, size_t &position);
 
   /** @brief Parses a SML PublicOpen.Res message
    *  @param buffer A pointer to a array of unsigned char
@@ -49,7 +239,8 @@ public:
    *  @return pointer to SmlPublicOpenRes
    */
   SmlPublicOpenRes parseSmlPublicOpenRes(const unsigned char *buffer,
-                                         const int buffer_size, int &position);
+                                         const size_t buffer_size,
+                                         size_t &position);
 
   /** @brief Parses a SML PublicClose.Res message
    *  @param buffer A pointer to a array of unsigned char
@@ -58,8 +249,8 @@ public:
    *  @return pointer to SmlPublicCloseRes
    */
   SmlPublicCloseRes parseSmlPublicCloseRes(const unsigned char *buffer,
-                                           const int buffer_size,
-                                           int &position);
+                                           const size_t buffer_size,
+                                           size_t &position);
 
   /** @brief Parses a SML GetList.Res message
    *  @param buffer A pointer to a array of unsigned char
@@ -68,7 +259,27 @@ public:
    *  @return pointer to SmlGetListRes
    */
   SmlGetListRes parseSmlGetListRes(const unsigned char *buffer,
-                                   const int buffer_size, int &position);
+                                   const size_t buffer_size, size_t &position);
+
+  /** @brief Parses a SML GetList.Res message into existing storage
+   *  @param buffer A pointer to a array of unsigned char
+   *  @param buffer_size Size of the buffer to lex
+   *  @param position the positon in the buffer where to start parsing
+   *  @param ret Receives the message. valList is cleared but keeps its
+   *         capacity, so it only allocates if the list got longer.
+   */
+  void parseSmlGetListRes(const unsigned char *buffer, const size_t buffer_size,
+                          size_t &position, SmlGetListRes &ret);
+
+  /** @brief Parses a SML GetList.Res message entry by entry
+   *  @param buffer A pointer to a array of unsigned char
+   *  @param buffer_size Size of the buffer to lex
+   *  @param position the positon in the buffer where to start parsing
+   *  @param visitor Receives every list entry through onListEntry()
+   */
+  template <typename Visitor>
+  void parseSmlGetListRes(const unsigned char *buffer, const size_t buffer_size,
+                          size_t &position, Visitor &visitor);
 
   /** @brief Parses a SML input stream as unsigned char for SMLListEntries
    *  @param buffer A pointer to a array of unsigned char
@@ -76,14 +287,30 @@ public:
    *  @param position the position pointer wehere to start parsing
    *  @return SmlListEntry
    */
-  SmlListEntry parseSmlListEntry(const unsigned char *buffer, const int buffer_size,
-                               int &position);
+  SmlListEntry parseSmlListEntry(const unsigned char *buffer, const size_t buffer_size,
+                               size_t &position);
 
-  /** @brief Searches a SmlListEntry and returns it
+  /** @brief Searches a SmlListEntry through the OBIS index
    *  @param obis The OBIS to search for
-   *  @return SmlListEntry
+   *  @return reference to the SmlListEntry in the last GetList.Res
+   *  @return reference to an empty SmlListEntry if obis was not found
    */
-  SmlListEntry getElementByObis(std::string obis);
+  const SmlListEntry &getElementByObis(const ObisCode obis) const;
+
+  /** @brief Searches a SmlListEntry by its raw OBIS bytes
+   *  @param obis The OBIS to search for as string of six bytes
+   *  @return see getElementByObis(const ObisCode)
+   */
+  const SmlListEntry &getElementByObis(const std::string &obis) const;
+
+  /** @brief Resolves many OBIS codes in one call
+   *  @param codes The OBIS codes to search for
+   *  @param results Receives a pointer to the entry per code, NULL if the
+   *         code was not found. Has to be at least as large as codes.
+   *  @return number of codes that were found
+   */
+  size_t getElementsByObis(std::span<const ObisCode> codes,
+                           std::span<const SmlListEntry *> results) const;
 
   /** @brief Returns a string representation os a SMLUnit
    *  @param SmlUnit hex-ID of the SmlUnit
@@ -91,7 +318,118 @@ public:
   */
  std::string getUnitAsString(uint8_t unit);
 
-  void hexPrint(const unsigned char *buffer, int &position);
+  void hexPrint(const unsigned char *buffer, const size_t buffer_size,
+                size_t &position);
 };
 
+template <typename Visitor> sml_error_t SmlParser::parseSml(Visitor &visitor)
+{
+  return parseFrameAt(0, visitor);
+}
+
+template <typename Visitor> sml_error_t SmlParser::parseNext(Visitor &visitor)
+{
+  size_t start = findNextFrame();
+  if (start == SML_NPOS)
+  {
+    return SML_END_OF_DATA;
+  }
+  return parseFrameAt(start, visitor);
+}
+
+template <typename Visitor>
+sml_error_t SmlParser::parseFrameAt(const size_t from, Visitor &visitor)
+{
+  SmlCrc16 frameCrc;
+  sml_error_t result = parseFrameStart(frameCrc, from);
+
+  bool closed = false;
+  while (result == SML_OK && position < buffer_size)
+  {
+    uint16_t messageType = 0;
+    result = parseSmlMessage(buffer, buffer_size, position, messageType,
+                             visitor, &frameCrc);
+    if (result == SML_OK && messageType == SML_MSG_TYPE_PUBCLOS_RES)
+    {
+      result = parseEndOfFrame(buffer, buffer_size, position, frameCrc);
+      closed = true;
+      break;
+    }
+  }
+  if (result == SML_OK && !closed)
+  {
+    // the buffer ended before PublicClose.Res
+    result = SML_ERROR_SIZE;
+  }
+
+  if (result != SML_OK)
+  {
+    visitor.onError(result);
+  }
+  return endFrame(result);
+}
+
+template <typename Visitor>
+sml_error_t SmlParser::parseSmlMessage(const unsigned char *buffer,
+                                       const size_t buffer_size,
+                                       size_t &position,
+                                       uint16_t &messageType, Visitor &visitor,
+                                       SmlCrc16 *frameCrc)
+{
+  const size_t start = position;
+  sml_error_t result =
+      parseSmlMessageHead(buffer, buffer_size, position, messageType);
+  if (result != SML_OK)
+  {
+    return result;
+  }
+
+  switch (messageType)
+  {
+  case SML_MSG_TYPE_PUBOPEN_RES:
+    visitor.onOpenRes(parseSmlPublicOpenRes(buffer, buffer_size, position));
+    break;
+  case SML_MSG_TYPE_GETLIST_RES:
+    parseSmlGetListRes(buffer, buffer_size, position, visitor);
+    break;
+  case SML_MSG_TYPE_PUBCLOS_RES:
+    visitor.onCloseRes(parseSmlPublicCloseRes(buffer, buffer_size, position));
+    break;
+  default:
+    result = skipSmlMessageBody(buffer, buffer_size, position, messageType);
+    if (result != SML_OK)
+    {
+      return result;
+    }
+    break;
+  }
+
+  return parseSmlMessageTail(buffer, buffer_size, position, start, frameCrc);
+}
+
+template <typename Visitor>
+void SmlParser::parseSmlGetListRes(const unsigned char *buffer,
+                                   const size_t buffer_size, size_t &position,
+                                   Visitor &visitor)
+{
+  // the head fields only, valList stays empty and never allocates
+  SmlGetListRes listRes{std::pmr::null_memory_resource()};
+  int valListLength =
+      parseSmlGetListResHead(buffer, buffer_size, position, listRes);
+  visitor.onListStart(listRes);
+
+  for (int i = 0; i < valListLength; i++)
+  {
+    if (skipUnwantedListEntry(buffer, buffer_size, position))
+    {
+      continue;
+    }
+    const SmlListEntryView entry =
+        parseSmlListEntry(buffer, buffer_size, position);
+    visitor.onListEntry(entry);
+  }
+
+  parseSmlGetListResTail(buffer, buffer_size, position, listRes);
+}
+
 #endif // SML_PARSER_HPP
\ No newline at end of file
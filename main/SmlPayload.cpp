@@ -0,0 +1,236 @@
+#include "SmlPayload.hpp"
+#include <cstring>
+
+// CBOR major types and simple values, RFC 8949
+static const uint8_t CBOR_UNSIGNED = 0;
+static const uint8_t CBOR_NEGATIVE = 1;
+static const uint8_t CBOR_TEXT = 3;
+static const uint8_t CBOR_ARRAY = 4;
+static const uint8_t CBOR_TAG = 6;
+static const uint8_t CBOR_MAP_INDEFINITE = 0xbf;
+static const uint8_t CBOR_BREAK = 0xff;
+static const uint64_t CBOR_TAG_DECIMAL_FRACTION = 4;
+
+// scalers written without exponent
+static const int8_t PLAIN_SCALER_LIMIT = 9;
+
+size_t sml_format_decimal(uint64_t magnitude, const bool negative,
+                          const int8_t scaler, char *out) {
+  // digits backwards, at most 20 for 64 bits
+  char digits[20];
+  size_t count = 0;
+  do {
+    digits[count++] = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+
+  size_t length = 0;
+  if (negative) {
+    out[length++] = '-';
+  }
+
+  if (scaler > PLAIN_SCALER_LIMIT || scaler < -PLAIN_SCALER_LIMIT) {
+    while (count > 0) {
+      out[length++] = digits[--count];
+    }
+    out[length++] = 'e';
+    int exponent = scaler;
+    if (exponent < 0) {
+      out[length++] = '-';
+      exponent = -exponent;
+    }
+    if (exponent >= 100) {
+      out[length++] = static_cast<char>('0' + exponent / 100);
+    }
+    if (exponent >= 10) {
+      out[length++] = static_cast<char>('0' + exponent / 10 % 10);
+    }
+    out[length++] = static_cast<char>('0' + exponent % 10);
+    return length;
+  }
+
+  if (scaler >= 0) {
+    while (count > 0) {
+      out[length++] = digits[--count];
+    }
+    if (length > 1 || out[0] != '0') {
+      for (int8_t i = 0; i < scaler; ++i) {
+        out[length++] = '0';
+      }
+    }
+    return length;
+  }
+
+  const size_t fraction = static_cast<size_t>(-scaler);
+  if (count <= fraction) {
+    out[length++] = '0';
+  } else {
+    while (count > fraction) {
+      out[length++] = digits[--count];
+    }
+  }
+  out[length++] = '.';
+  for (size_t i = count; i < fraction; ++i) {
+    out[length++] = '0';
+  }
+  while (count > 0) {
+    out[length++] = digits[--count];
+  }
+  return length;
+}
+
+// splits a numeric entry into sign and magnitude, INT64_MIN included
+static bool splitValue(const SmlListEntry &entry, uint64_t &magnitude,
+                       bool &negative) {
+  if (entry.type() == SmlValueType::Unsigned) {
+    magnitude = entry.iValue();
+    negative = false;
+    return true;
+  }
+  if (entry.type() == SmlValueType::Integer) {
+    const int64_t value = static_cast<int64_t>(entry.iValue());
+    magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+    negative = value < 0;
+    return true;
+  }
+  return false;
+}
+
+size_t sml_format_value(const SmlListEntry &entry, char *out) {
+  uint64_t magnitude;
+  bool negative;
+  if (!splitValue(entry, magnitude, negative)) {
+    return 0;
+  }
+  return sml_format_decimal(magnitude, negative, entry.scaler(), out);
+}
+
+SmlPayloadWriter::SmlPayloadWriter(char *t_buffer, const size_t t_capacity,
+                                   const SmlPayloadFormat t_format)
+    : buffer{t_buffer}, capacity{t_capacity}, format{t_format} {}
+
+void SmlPayloadWriter::write(const void *data, const size_t size) {
+  if (overflow || size > capacity - length) {
+    overflow = true;
+    return;
+  }
+  memcpy(&buffer[length], data, size);
+  length += size;
+}
+
+void SmlPayloadWriter::writeByte(const uint8_t byte) { write(&byte, 1); }
+
+void SmlPayloadWriter::writeCborHead(const uint8_t major,
+                                     const uint64_t value) {
+  const uint8_t type = static_cast<uint8_t>(major << 5);
+  uint8_t head[9];
+  size_t size;
+  if (value < 24) {
+    head[0] = static_cast<uint8_t>(type | value);
+    size = 1;
+  } else if (value <= 0xff) {
+    head[0] = type | 24;
+    size = 2;
+  } else if (value <= 0xffff) {
+    head[0] = type | 25;
+    size = 3;
+  } else if (value <= 0xffffffff) {
+    head[0] = type | 26;
+    size = 5;
+  } else {
+    head[0] = type | 27;
+    size = 9;
+  }
+  // big endian argument
+  for (size_t i = 1; i < size; ++i) {
+    head[i] = static_cast<uint8_t>(value >> (8 * (size - 1 - i)));
+  }
+  write(head, size);
+}
+
+void SmlPayloadWriter::writeCborInteger(const uint64_t magnitude,
+                                        const bool negative) {
+  if (negative && magnitude != 0) {
+    writeCborHead(CBOR_NEGATIVE, magnitude - 1);
+  } else {
+    writeCborHead(CBOR_UNSIGNED, magnitude);
+  }
+}
+
+void SmlPayloadWriter::writeKey(const char *key) {
+  const size_t keyLength = strlen(key);
+  if (format == SmlPayloadFormat::Cbor) {
+    writeCborHead(CBOR_TEXT, keyLength);
+    write(key, keyLength);
+    return;
+  }
+  write(",\"", 2);
+  write(key, keyLength);
+  write("\":", 2);
+}
+
+void SmlPayloadWriter::begin(const uint32_t time) {
+  length = 0;
+  values = 0;
+  overflow = false;
+  if (format == SmlPayloadFormat::Cbor) {
+    writeByte(CBOR_MAP_INDEFINITE);
+    writeKey("time");
+    writeCborHead(CBOR_UNSIGNED, time);
+    return;
+  }
+  write("{\"time\":", 8);
+  char text[SML_DECIMAL_MAX_LENGTH];
+  write(text, sml_format_decimal(time, false, 0, text));
+}
+
+bool SmlPayloadWriter::add(const char *key, const uint64_t magnitude,
+                           const bool negative, const int8_t scaler) {
+  if (overflow) {
+    return false; // begin() did not fit
+  }
+  const size_t start = length;
+  writeKey(key);
+  if (format == SmlPayloadFormat::Cbor) {
+    if (scaler == 0) {
+      writeCborInteger(magnitude, negative);
+    } else {
+      // decimal fraction: [exponent, mantissa]
+      writeCborHead(CBOR_TAG, CBOR_TAG_DECIMAL_FRACTION);
+      writeCborHead(CBOR_ARRAY, 2);
+      writeCborInteger(scaler < 0 ? static_cast<uint64_t>(-scaler)
+                                  : static_cast<uint64_t>(scaler),
+                       scaler < 0);
+      writeCborInteger(magnitude, negative);
+    }
+  } else {
+    char text[SML_DECIMAL_MAX_LENGTH];
+    write(text, sml_format_decimal(magnitude, negative, scaler, text));
+  }
+
+  // a value that leaves no room for the end of the map is dropped, the
+  // document stays complete without it
+  if (overflow || length == capacity) {
+    length = start;
+    overflow = false;
+    return false;
+  }
+  ++values;
+  return true;
+}
+
+bool SmlPayloadWriter::add(const char *key, const SmlListEntry &entry) {
+  uint64_t magnitude;
+  bool negative;
+  return splitValue(entry, magnitude, negative) &&
+         add(key, magnitude, negative, entry.scaler());
+}
+
+bool SmlPayloadWriter::finish() {
+  if (format == SmlPayloadFormat::Cbor) {
+    writeByte(CBOR_BREAK);
+  } else {
+    writeByte('}');
+  }
+  return !overflow;
+}
@@ -0,0 +1,102 @@
+#ifndef SML_PAYLOAD_HPP
+#define SML_PAYLOAD_HPP
+
+#include "SmlTypes.hpp"
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Longest text written by sml_format_decimal() */
+const size_t SML_DECIMAL_MAX_LENGTH = 32;
+
+/** @brief Formats an unscaled value as exact decimal number, e.g. 123456
+ *  with scaler -1 as "12345.6", without floating point
+ *  @param magnitude Absolute value
+ *  @param negative true for a negative value
+ *  @param scaler Power of ten, beyond +-9 an exponent ("123e12") is used
+ *  @param out Receives up to SML_DECIMAL_MAX_LENGTH characters, not
+ *         terminated
+ *  @return number of characters written
+ */
+size_t sml_format_decimal(uint64_t magnitude, const bool negative,
+                          const int8_t scaler, char *out);
+
+/** @brief Formats the value of a list entry, see sml_format_decimal()
+ *  @param entry The entry
+ *  @param out Receives up to SML_DECIMAL_MAX_LENGTH characters
+ *  @return number of characters written, 0 if the entry holds no number
+ */
+size_t sml_format_value(const SmlListEntry &entry, char *out);
+
+enum class SmlPayloadFormat { Json, Cbor };
+
+/** @brief Builds one document with the readings of a frame
+ *
+ *  The document is a map of the time stamp and one value per reading, keyed
+ *  by its OBIS name (see SmlTopicMap::getName()):
+ *  JSON {"time":1234,"1-0:1.8.0":12345.6,...} or the same as CBOR map of
+ *  indefinite length, with values as integers or decimal fractions
+ *  (tag 4). Values are formatted from the unscaled integers, so they are
+ *  exact and no floating point is involved.
+ *
+ *  Everything is written into the buffer given to the constructor, which
+ *  is reused by the next begin(). Nothing is allocated.
+ */
+class SmlPayloadWriter {
+private:
+  char *buffer;
+  size_t capacity;
+  size_t length{0};
+  size_t values{0};
+  bool overflow{false};
+  SmlPayloadFormat format;
+
+  void write(const void *data, const size_t size);
+  void writeByte(const uint8_t byte);
+  void writeCborHead(const uint8_t major, const uint64_t value);
+  void writeCborInteger(const uint64_t magnitude, const bool negative);
+  void writeKey(const char *key);
+
+public:
+  /** @brief Creates a writer
+   *  @param t_buffer Storage of the document, has to outlive the writer
+   *  @param t_capacity Size of the storage
+   *  @param t_format Encoding of the document
+   */
+  SmlPayloadWriter(char *t_buffer, const size_t t_capacity,
+                   const SmlPayloadFormat t_format = SmlPayloadFormat::Json);
+
+  /** @brief Starts a new document, the previous one is dropped
+   *  @param time Time stamp of the readings, e.g. actSensorTime
+   */
+  void begin(const uint32_t time);
+
+  /** @brief Adds an unscaled value
+   *  @param key Name of the value, plain ASCII that needs no escaping
+   *  @param magnitude Absolute value
+   *  @param negative true for a negative value
+   *  @param scaler Power of ten to apply
+   *  @return false if the buffer is full
+   */
+  bool add(const char *key, const uint64_t magnitude, const bool negative,
+           const int8_t scaler);
+
+  /** @brief Adds the value of a list entry
+   *  @param key see add(const char *, uint64_t, bool, int8_t)
+   *  @param entry The entry, skipped unless it holds a number
+   *  @return false if the entry was skipped or the buffer is full
+   */
+  bool add(const char *key, const SmlListEntry &entry);
+
+  /** @brief Closes the document
+   *  @return false if it did not fit into the buffer
+   */
+  bool finish();
+
+  /** @brief Returns the number of values added since begin() */
+  size_t getValueCount() const { return values; }
+
+  const char *data() const { return buffer; }
+  size_t size() const { return overflow ? 0 : length; }
+};
+
+#endif // SML_PAYLOAD_HPP
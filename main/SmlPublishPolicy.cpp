@@ -0,0 +1,77 @@
+#include "SmlPublishPolicy.hpp"
+#include <cmath>
+
+static bool isNumber(const SmlListEntry &entry) {
+  return entry.type() == SmlValueType::Unsigned ||
+         entry.type() == SmlValueType::Integer;
+}
+
+SmlPublishPolicy::SmlPublishPolicy(std::span<const SmlDeadband> t_rules,
+                                   std::span<SmlPublishState> t_states)
+    : rules{t_rules}, states{t_states} {
+  for (size_t i = 0; i < rules.size() && i < states.size(); ++i) {
+    if (states[i].obis != rules[i].obis.packed) {
+      states[i] = SmlPublishState{};
+      states[i].obis = rules[i].obis.packed;
+    }
+  }
+}
+
+SmlPublishState *SmlPublishPolicy::find(const ObisCode obis,
+                                        const SmlDeadband *&rule) const {
+  // a handful of rules, a linear search beats anything else
+  for (size_t i = 0; i < rules.size() && i < states.size(); ++i) {
+    if (rules[i].obis == obis) {
+      rule = &rules[i];
+      return &states[i];
+    }
+  }
+  return nullptr;
+}
+
+bool SmlPublishPolicy::isDue(const ObisCode obis, const double value,
+                             const uint32_t now) const {
+  const SmlDeadband *rule = nullptr;
+  const SmlPublishState *state = find(obis, rule);
+  if (state == nullptr || !state->published) {
+    return true;
+  }
+
+  // unsigned difference, survives the wrap of the time stamp
+  if (rule->maxSilence != 0 && now - state->time >= rule->maxSilence) {
+    return true;
+  }
+
+  const double band =
+      std::fmax(rule->absolute, rule->relative * std::fabs(state->value));
+  return std::fabs(value - state->value) > band;
+}
+
+bool SmlPublishPolicy::isDue(const SmlListEntry &entry,
+                             const uint32_t now) const {
+  return isNumber(entry) && isDue(entry.obis(), entry.value(), now);
+}
+
+void SmlPublishPolicy::setPublished(const ObisCode obis, const double value,
+                                    const uint32_t now) {
+  const SmlDeadband *rule = nullptr;
+  SmlPublishState *state = find(obis, rule);
+  if (state != nullptr) {
+    state->value = value;
+    state->time = now;
+    state->published = true;
+  }
+}
+
+void SmlPublishPolicy::setPublished(const SmlListEntry &entry,
+                                    const uint32_t now) {
+  if (isNumber(entry)) {
+    setPublished(entry.obis(), entry.value(), now);
+  }
+}
+
+void SmlPublishPolicy::reset() {
+  for (size_t i = 0; i < rules.size() && i < states.size(); ++i) {
+    states[i].published = false;
+  }
+}
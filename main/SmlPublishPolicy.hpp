@@ -0,0 +1,81 @@
+#ifndef SML_PUBLISH_POLICY_HPP
+#define SML_PUBLISH_POLICY_HPP
+
+#include "SmlTypes.hpp"
+#include <span>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief When a reading of one OBIS code is worth publishing */
+struct SmlDeadband {
+  ObisCode obis;
+  double absolute;     // least change to publish, in scaled units
+  double relative;     // least change to publish, as share of the last value
+  uint32_t maxSilence; // seconds after which the value is published anyway,
+                       // 0 to wait for a change forever
+};
+
+/** @brief What was last published of one OBIS code */
+struct SmlPublishState {
+  uint64_t obis{0}; // code of the rule, detects a changed rule table
+  double value{0.0};
+  uint32_t time{0};
+  bool published{false};
+};
+
+/** @brief Decides which readings are published
+ *
+ *  A reading is published if nothing was published for its OBIS code yet,
+ *  if it differs from the last published value by more than the larger of
+ *  the absolute and the relative deadband, or if maxSilence seconds passed
+ *  since. With both deadbands 0, every change is published.
+ *
+ *  The state is kept in caller-provided storage, in RTC memory
+ *  (RTC_DATA_ATTR) it survives deep sleep. Entries that do not belong to the
+ *  rule at the same index are reset, so zeroed storage works as well as a
+ *  changed rule table.
+ */
+class SmlPublishPolicy {
+private:
+  std::span<const SmlDeadband> rules;
+  std::span<SmlPublishState> states;
+
+  SmlPublishState *find(const ObisCode obis, const SmlDeadband *&rule) const;
+
+public:
+  /** @brief Creates a policy
+   *  @param t_rules One rule per OBIS code, has to outlive the policy
+   *  @param t_states One entry per rule, has to outlive the policy. Rules
+   *         without an entry are always published.
+   */
+  SmlPublishPolicy(std::span<const SmlDeadband> t_rules,
+                   std::span<SmlPublishState> t_states);
+
+  /** @brief Tells whether a reading has to be published
+   *  @param obis The OBIS code of the reading
+   *  @param value The scaled value
+   *  @param now Time stamp of the reading in seconds, e.g. actSensorTime
+   *  @return true if it qualifies or there is no rule for obis
+   */
+  bool isDue(const ObisCode obis, const double value,
+             const uint32_t now) const;
+
+  /** @brief isDue() for a list entry, entries without a number are not due
+   */
+  bool isDue(const SmlListEntry &entry, const uint32_t now) const;
+
+  /** @brief Records a reading as published
+   *
+   *  Call it once the publish succeeded, so a failed one is retried with
+   *  the next reading.
+   */
+  void setPublished(const ObisCode obis, const double value,
+                    const uint32_t now);
+
+  void setPublished(const SmlListEntry &entry, const uint32_t now);
+
+  /** @brief Forgets all published values, everything is due again */
+  void reset();
+};
+
+#endif // SML_PUBLISH_POLICY_HPP
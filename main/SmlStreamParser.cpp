@@ -0,0 +1,447 @@
+#include "SmlStreamParser.hpp"
+#include <algorithm>
+
+SmlStreamParser::SmlStreamParser(unsigned char *t_storage,
+                                 size_t t_storage_size, SmlArena *t_arena)
+    : storage{t_storage}, storage_size{t_storage_size}, length{0},
+      parser{t_storage, t_storage_size, t_arena}
+{
+  paddingCount = 0;
+  frameEnded = false;
+  resync();
+}
+
+void SmlStreamParser::setMessageHandler(SmlMessageHandler handler)
+{
+  messageHandler = handler;
+}
+
+void SmlStreamParser::setFrameHandler(SmlFrameHandler handler)
+{
+  frameHandler = handler;
+}
+
+SmlParser &SmlStreamParser::getParser() { return parser; }
+
+uint8_t SmlStreamParser::getPaddingCount() const { return paddingCount; }
+
+void SmlStreamParser::reset() { resync(); }
+
+void SmlStreamParser::resync()
+{
+  state = State::Hunting;
+  frameCrc.init();
+  crcPosition = 0;
+  startMatched = 0;
+  length = 0;
+  messageStart = 0;
+  trailerStart = 0;
+  replayPosition = 0;
+  replayEnd = 0;
+  depth = 0;
+  payloadLeft = 0;
+  tlLength = 0;
+  tlBytes = 0;
+  tlType = SmlTlType::Invalid;
+  inTl = false;
+}
+
+sml_error_t SmlStreamParser::startFrame()
+{
+  if (storage_size < SML_START_SEQUENCE_LENGTH + SML_END_SEQUENCE_LENGTH)
+  {
+    SmlLogger::Error("Stream storage of %zu bytes is too small",
+                     storage_size);
+    return SML_ERROR_SIZE;
+  }
+
+  parser.beginFrame();
+  memcpy(storage, SML_START_SEQUENCE, SML_START_SEQUENCE_LENGTH);
+  length = SML_START_SEQUENCE_LENGTH;
+  frameCrc.init();
+  crcPosition = 0;
+  state = State::Messages;
+  depth = 0;
+  payloadLeft = 0;
+  inTl = false;
+  SmlLogger::Verbose("Start sequence received");
+  return SML_OK;
+}
+
+sml_error_t SmlStreamParser::feed(const uint8_t *data, size_t data_length)
+{
+  size_t consumed = 0;
+  return feedBytes(data, data_length, false, consumed);
+}
+
+sml_error_t SmlStreamParser::feed(const uint8_t *data, size_t data_length,
+                                  size_t &consumed)
+{
+  return feedBytes(data, data_length, true, consumed);
+}
+
+sml_error_t SmlStreamParser::feedBytes(const uint8_t *data,
+                                       const size_t data_length,
+                                       const bool stopAfterFrame,
+                                       size_t &consumed)
+{
+  consumed = 0;
+  if (data == nullptr)
+  {
+    return SML_ERROR_NULLPTR;
+  }
+
+  frameEnded = false;
+  sml_error_t result = replay(stopAfterFrame);
+  size_t i = 0;
+  while (i < data_length && !(stopAfterFrame && frameEnded))
+  {
+    if (state == State::Hunting && startMatched == 0)
+    {
+      // skip line noise with the frame sync scanner, only a start sequence
+      // split across two calls is matched byte by byte
+      const size_t remaining = data_length - i;
+      const size_t found = sml_find_start_sequence(&data[i], remaining, 0);
+      if (found != SML_NPOS)
+      {
+        i += found + SML_START_SEQUENCE_LENGTH;
+        sml_error_t frameResult = startFrame();
+        if (frameResult != SML_OK)
+        {
+          result = frameResult;
+          resync();
+        }
+        continue;
+      }
+
+      if (remaining > SML_START_SEQUENCE_LENGTH)
+      {
+        i += remaining - SML_START_SEQUENCE_LENGTH;
+      }
+    }
+
+    bool taken = true;
+    sml_error_t byteResult = consume(data[i], taken);
+    if (byteResult != SML_OK)
+    {
+      result = byteResult;
+      dropFrame(replayEnd);
+      byteResult = replay(stopAfterFrame);
+      if (byteResult != SML_OK)
+      {
+        result = byteResult;
+      }
+    }
+    // a byte the broken frame did not take is fed again behind the replay
+    if (taken)
+    {
+      ++i;
+    }
+  }
+  consumed = i;
+
+  // add this chunk to the transport CRC, but never the CRC bytes themselves
+  if (state == State::Messages)
+  {
+    updateFrameCrc(length);
+  }
+  else if (state == State::Trailer)
+  {
+    updateFrameCrc(std::min(length, trailerStart + SML_END_SEQUENCE_LENGTH - 2));
+  }
+
+  return result;
+}
+
+sml_error_t SmlStreamParser::consume(const unsigned char element, bool &taken)
+{
+  const State current = state;
+  const size_t stored = length;
+  sml_error_t result = SML_OK;
+  switch (state)
+  {
+  case State::Hunting:
+    result = consumeStartSequence(element);
+    break;
+  case State::Messages:
+    result = consumeMessageByte(element);
+    break;
+  case State::Trailer:
+    result = consumeTrailerByte(element);
+    break;
+  }
+
+  // bytes rejected before they were stored may start the next frame
+  taken = result == SML_OK || current == State::Hunting || length != stored;
+  return result;
+}
+
+void SmlStreamParser::dropFrame(const size_t restFrom)
+{
+  if (state == State::Hunting)
+  {
+    resync();
+    return;
+  }
+
+  // replay the frame behind its start sequence, followed by what is left of
+  // an earlier replay. Bytes only move towards the start of the storage,
+  // frame bytes are stored at length <= replayPosition while replaying.
+  const size_t rest = replayEnd > restFrom ? replayEnd - restFrom : 0;
+  memmove(&storage[length], &storage[restFrom], rest);
+  const size_t end = length + rest;
+  resync();
+  if (end > SML_START_SEQUENCE_LENGTH)
+  {
+    replayPosition = SML_START_SEQUENCE_LENGTH;
+    replayEnd = end;
+  }
+}
+
+sml_error_t SmlStreamParser::replay(const bool stopAfterFrame)
+{
+  sml_error_t result = SML_OK;
+  while (replayPosition < replayEnd && !(stopAfterFrame && frameEnded))
+  {
+    bool taken = true;
+    const sml_error_t byteResult = consume(storage[replayPosition], taken);
+    if (byteResult != SML_OK)
+    {
+      result = byteResult;
+      dropFrame(taken ? replayPosition + 1 : replayPosition);
+      continue;
+    }
+    ++replayPosition;
+  }
+  return result;
+}
+
+void SmlStreamParser::updateFrameCrc(size_t end)
+{
+  if (end > crcPosition)
+  {
+    frameCrc.update(&storage[crcPosition], end - crcPosition);
+    crcPosition = end;
+  }
+}
+
+sml_error_t SmlStreamParser::consumeStartSequence(const unsigned char element)
+{
+  if (element == SML_START_SEQUENCE[startMatched])
+  {
+    ++startMatched;
+  }
+  else if (element == 0x1b)
+  {
+    // four 0x1b followed by another one still end in four 0x1b
+    startMatched = startMatched == 4 ? 4 : 1;
+  }
+  else
+  {
+    startMatched = 0;
+  }
+
+  if (startMatched == SML_START_SEQUENCE_LENGTH)
+  {
+    return startFrame();
+  }
+
+  return SML_OK;
+}
+
+sml_error_t SmlStreamParser::consumeMessageByte(const unsigned char element)
+{
+  const bool atTopLevel = depth == 0 && !inTl && payloadLeft == 0;
+
+  if (length >= storage_size)
+  {
+    SmlLogger::Error("Frame exceeds stream storage of %zu bytes",
+                     storage_size);
+    return SML_ERROR_SIZE;
+  }
+
+  if (atTopLevel)
+  {
+    if (element == 0x1b)
+    {
+      trailerStart = length;
+      storage[length++] = element;
+      state = State::Trailer;
+      return SML_OK;
+    }
+
+    if (element == 0x00)
+    {
+      // padding between the last message and the end sequence
+      storage[length++] = element;
+      return SML_OK;
+    }
+
+    if (SML_TL_TABLE[element].type != SmlTlType::List)
+    {
+      SmlLogger::Error("Syntax error. Expected a SML message but found %02x",
+                       element);
+      return SML_ERROR_SYNTAX;
+    }
+    messageStart = length;
+  }
+
+  storage[length++] = element;
+
+  if (payloadLeft > 0)
+  {
+    --payloadLeft;
+    if (payloadLeft == 0 && elementDone())
+    {
+      return finishMessage();
+    }
+    return SML_OK;
+  }
+
+  const SmlTlInfo &tl = SML_TL_TABLE[element];
+  if (!inTl)
+  {
+    tlType = tl.type;
+    tlLength = 0;
+    tlBytes = 0;
+    inTl = true;
+  }
+  tlLength = (tlLength << 4) | tl.length;
+  ++tlBytes;
+
+  if (tl.more)
+  {
+    if (tlBytes >= 4)
+    {
+      SmlLogger::Error("Syntax error. TL field too long");
+      return SML_ERROR_SYNTAX;
+    }
+    return SML_OK;
+  }
+  inTl = false;
+
+  if (tlType == SmlTlType::Invalid)
+  {
+    SmlLogger::Error("Syntax error. Invalid TL byte %02x", element);
+    return SML_ERROR_SYNTAX;
+  }
+
+  if (tlType == SmlTlType::List)
+  {
+    if (tlLength == 0)
+    {
+      return elementDone() ? finishMessage() : SML_OK;
+    }
+    if (depth >= MAX_DEPTH)
+    {
+      SmlLogger::Error("Syntax error. Lists nested deeper than %d", MAX_DEPTH);
+      return SML_ERROR_SYNTAX;
+    }
+    pending[depth++] = tlLength;
+    return SML_OK;
+  }
+
+  // EndOfSmlMsg (0x00) has no payload, all other lengths include the TL
+  int payload = tlLength == 0 ? 0 : tlLength - tlBytes;
+  if (payload < 0)
+  {
+    SmlLogger::Error("Syntax error. Invalid length in TL byte %02x", element);
+    return SML_ERROR_SYNTAX;
+  }
+
+  if (payload == 0)
+  {
+    return elementDone() ? finishMessage() : SML_OK;
+  }
+  payloadLeft = payload;
+
+  return SML_OK;
+}
+
+sml_error_t SmlStreamParser::consumeTrailerByte(const unsigned char element)
+{
+  if (length >= storage_size)
+  {
+    SmlLogger::Error("Frame exceeds stream storage of %zu bytes",
+                     storage_size);
+    return SML_ERROR_SIZE;
+  }
+  storage[length++] = element;
+
+  size_t offset = length - 1 - trailerStart;
+  if ((offset < 4 && element != 0x1b) || (offset == 4 && element != 0x1a))
+  {
+    SmlLogger::Error("Syntax error. Expected end sequence but found %02x",
+                     element);
+    return SML_ERROR_SYNTAX;
+  }
+
+  if (offset + 1 < SML_END_SEQUENCE_LENGTH)
+  {
+    return SML_OK;
+  }
+
+  // everything up to the padding count, the CRC bytes are the last two
+  updateFrameCrc(length - 2);
+  uint16_t computedCrc = frameCrc.final();
+  uint16_t crc16 =
+      static_cast<uint16_t>((storage[length - 2] << 8) | storage[length - 1]);
+  if (crc16 != computedCrc)
+  {
+    SmlLogger::Error("Transport CRC error: Should be %04x, but is %04x", crc16,
+                     computedCrc);
+    return SML_ERROR_CRC;
+  }
+  paddingCount = storage[trailerStart + 5];
+
+  SmlLogger::Info("---------- End of frame ----------\n");
+  if (frameHandler)
+  {
+    frameHandler(parser);
+  }
+
+  // the storage keeps the frame until the next start sequence arrived
+  state = State::Hunting;
+  startMatched = 0;
+  frameEnded = true;
+  return SML_OK;
+}
+
+bool SmlStreamParser::elementDone()
+{
+  while (depth > 0)
+  {
+    if (--pending[depth - 1] > 0)
+    {
+      return false;
+    }
+    --depth;
+  }
+  return true;
+}
+
+sml_error_t SmlStreamParser::finishMessage()
+{
+  size_t position = messageStart;
+  uint16_t messageType = 0;
+
+  sml_error_t result =
+      parser.parseSmlMessage(storage, length, position, messageType);
+  if (result != SML_OK)
+  {
+    return result;
+  }
+
+  if (position != length)
+  {
+    SmlLogger::Warning("Message parser stopped at %zu, message ends at %zu",
+                       position, length);
+  }
+
+  if (messageHandler)
+  {
+    messageHandler(messageType, parser);
+  }
+
+  return SML_OK;
+}
@@ -0,0 +1,150 @@
+#ifndef SML_STREAM_PARSER_HPP
+#define SML_STREAM_PARSER_HPP
+
+#include "SmlFrameSync.hpp"
+#include "SmlCrc.hpp"
+#include "SmlLogger.hpp"
+#include "SmlParser.hpp"
+#include "SmlTypeLength.hpp"
+#include "SmlTypes.hpp"
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Called for every message whose CRC closed successfully */
+using SmlMessageHandler =
+    std::function<void(uint16_t messageType, SmlParser &parser)>;
+
+/** @brief Called when the end sequence was received and the transport CRC
+ *  over the whole frame matched
+ *
+ *  The results are valid until the next start sequence is fed, which can be
+ *  in the same feed() call. Read them here, or use the feed() overload that
+ *  stops behind the frame.
+ */
+using SmlFrameHandler = std::function<void(SmlParser &parser)>;
+
+/** @brief Incremental (push mode) SML parser
+ *
+ *  Bytes are passed in with feed() as they arrive, e.g. straight from the
+ *  UART. The parser hunts for the start sequence, walks the TL structure of
+ *  each message across calls and hands every complete message to the
+ *  wrapped SmlParser as soon as its last byte arrived. The transport CRC is
+ *  updated with every chunk, so it is ready when the end sequence arrives.
+ *
+ *  The bytes of the current frame are kept in the storage given to the
+ *  constructor, so results of earlier messages of the same frame (which are
+ *  views into that storage) stay valid until the next frame starts.
+ *
+ *  A broken frame may have swallowed the start of the next one, e.g. when
+ *  the end of a frame got lost. Its bytes behind the start sequence are
+ *  therefore hunted through again before any new input.
+ */
+class SmlStreamParser {
+private:
+  enum class State { Hunting, Messages, Trailer };
+
+  static const int MAX_DEPTH = 16;
+
+  unsigned char *storage;
+  size_t storage_size;
+  size_t length;
+  SmlParser parser;
+  SmlMessageHandler messageHandler;
+  SmlFrameHandler frameHandler;
+
+  State state;
+  SmlCrc16 frameCrc;
+  size_t crcPosition;
+  uint8_t paddingCount;
+  int startMatched;
+  size_t messageStart;
+  size_t trailerStart;
+  bool frameEnded;
+
+  // bytes of a broken frame still to be hunted through, see dropFrame()
+  size_t replayPosition;
+  size_t replayEnd;
+
+  // TL walker state, kept across feed() calls
+  int pending[MAX_DEPTH];
+  int depth;
+  int payloadLeft;
+  int tlLength;
+  int tlBytes;
+  SmlTlType tlType;
+  bool inTl;
+
+  void resync();
+  void dropFrame(const size_t restFrom);
+  sml_error_t replay(const bool stopAfterFrame);
+  sml_error_t feedBytes(const uint8_t *data, const size_t data_length,
+                        const bool stopAfterFrame, size_t &consumed);
+  sml_error_t consume(const unsigned char element, bool &taken);
+  sml_error_t startFrame();
+  sml_error_t consumeStartSequence(const unsigned char element);
+  sml_error_t consumeMessageByte(const unsigned char element);
+  sml_error_t consumeTrailerByte(const unsigned char element);
+  bool elementDone();
+  void updateFrameCrc(size_t end);
+  sml_error_t finishMessage();
+
+public:
+  /** @brief Creates a stream parser working in caller-provided storage
+   *  @param t_storage Buffer that holds the bytes of the current frame
+   *  @param t_storage_size Size of the storage, i.e. the largest frame
+   *  @param t_arena Optional arena for the results, see SmlParser
+   */
+  SmlStreamParser(unsigned char *t_storage, size_t t_storage_size,
+                  SmlArena *t_arena = nullptr);
+
+  /** @brief Sets the callback invoked for every completed message
+   *  @param handler The callback
+   */
+  void setMessageHandler(SmlMessageHandler handler);
+
+  /** @brief Sets the callback invoked at the end of every frame
+   *  @param handler The callback
+   */
+  void setFrameHandler(SmlFrameHandler handler);
+
+  /** @brief Pushes received bytes into the parser
+   *  @param data Pointer to the received bytes
+   *  @param data_length Number of received bytes
+   *  @return SML_OK if all bytes were consumed without error
+   *  @return SML_ERROR_NULLPTR if data is NULL
+   *  @return SML_ERROR_SIZE if a frame did not fit into the storage
+   *  @return SML_ERROR_SYNTAX on a malformed message
+   *  @return SML_ERROR_CRC if a message or the transport CRC does not match
+   *  On errors the parser drops the frame and hunts for the next start
+   *  sequence, so feeding can simply continue.
+   */
+  sml_error_t feed(const uint8_t *data, size_t data_length);
+
+  /** @brief Pushes received bytes into the parser up to the end of a frame
+   *
+   *  Stops right behind the first frame that passed its transport CRC, so
+   *  its results stay valid after the call until the next one.
+   *  @param data Pointer to the received bytes
+   *  @param data_length Number of received bytes
+   *  @param consumed Receives the number of bytes taken, the rest has to be
+   *         fed again later
+   *  @return see feed(const uint8_t *, size_t)
+   */
+  sml_error_t feed(const uint8_t *data, size_t data_length, size_t &consumed);
+
+  /** @brief Returns the padding count of the last complete frame
+   *  @return number of 0x00 bytes the sender appended to the messages
+   */
+  uint8_t getPaddingCount() const;
+
+  /** @brief Drops any partial frame and starts hunting again */
+  void reset();
+
+  /** @brief Gives access to the parser holding the decoded results
+   *  @return SmlParser working on the storage of this stream parser
+   */
+  SmlParser &getParser();
+};
+
+#endif // SML_STREAM_PARSER_HPP
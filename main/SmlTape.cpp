@@ -0,0 +1,302 @@
+#include "SmlTape.hpp"
+#include "SmlCrc.hpp"
+#include "SmlFrameSync.hpp"
+#include "SmlLogger.hpp"
+#include <cmath>
+
+// fields of a list entry: objName, status, valTime, unit, scaler, value,
+// valueSignature
+static const int ENTRY_OBJ_NAME = 0;
+static const int ENTRY_STATUS = 1;
+static const int ENTRY_UNIT = 3;
+static const int ENTRY_SCALER = 4;
+static const int ENTRY_VALUE = 5;
+static const int ENTRY_SIGNATURE = 6;
+
+sml_error_t SmlTape::build(const unsigned char *t_buffer,
+                           const size_t t_buffer_size) {
+  buffer = t_buffer;
+  buffer_size = t_buffer_size;
+  elements.clear();
+  listEntries.clear();
+
+  if (buffer == nullptr || buffer_size == 0) {
+    return SML_ERROR_ZEROLENGTH;
+  }
+
+  // offsets are kept relative to the frame, so they fit 32 bits even if
+  // the frame lies deep inside a large capture
+  const size_t start = sml_find_start_sequence(buffer, buffer_size, 0);
+  if (start == SML_NPOS) {
+    return SML_ERROR_SIZE;
+  }
+  buffer += start;
+  buffer_size -= start;
+  size_t position = SML_START_SEQUENCE_LENGTH;
+
+  SmlLexer lexer;
+  int open[MAX_DEPTH];
+  int remaining[MAX_DEPTH];
+  int depth = 0;
+
+  for (;;) {
+    if (depth == 0) {
+      if (position >= buffer_size) {
+        return SML_ERROR_SIZE;
+      }
+      if (buffer[position] == 0x00) {
+        // padding between the last message and the end sequence
+        ++position;
+        continue;
+      }
+      if (buffer[position] == 0x1b) {
+        break;
+      }
+    }
+
+    SmlTlType type;
+    int length;
+    int tlBytes;
+    if (!lexer.getTypeLength(buffer, buffer_size, position, type, length,
+                             tlBytes)) {
+      SmlLogger::Error("Syntax error. Invalid TL field at %zu", position);
+      return SML_ERROR_SYNTAX;
+    }
+
+    const int index = static_cast<int>(elements.size());
+    elements.push_back(SmlTapeElement{static_cast<uint32_t>(position),
+                                      static_cast<uint32_t>(length),
+                                      static_cast<uint32_t>(index + 1), type,
+                                      static_cast<uint8_t>(tlBytes)});
+    position += tlBytes;
+
+    if (type == SmlTlType::List && length > 0) {
+      if (depth >= MAX_DEPTH) {
+        SmlLogger::Error("Syntax error. Lists nested deeper than %d",
+                         MAX_DEPTH);
+        return SML_ERROR_SYNTAX;
+      }
+      open[depth] = index;
+      remaining[depth] = length;
+      ++depth;
+      continue;
+    }
+
+    if (type != SmlTlType::List) {
+      if (static_cast<size_t>(length) > buffer_size - position) {
+        return SML_ERROR_SIZE;
+      }
+      position += length;
+    }
+
+    // close every list whose last element this was
+    while (depth > 0) {
+      if (--remaining[depth - 1] > 0) {
+        break;
+      }
+      elements[open[depth - 1]].next = static_cast<uint32_t>(elements.size());
+      --depth;
+    }
+  }
+
+  // end sequence 1b1b1b1b 1a, padding count, CRC16
+  if (position + 8 > buffer_size) {
+    return SML_ERROR_SIZE;
+  }
+  for (size_t i = 0; i < 4; ++i) {
+    if (buffer[position + i] != 0x1b) {
+      return SML_ERROR_SYNTAX;
+    }
+  }
+  if (buffer[position + 4] != 0x1a) {
+    return SML_ERROR_SYNTAX;
+  }
+
+  SmlCrc16 crc;
+  crc.update(buffer, position + 6);
+  const uint16_t crc16 = static_cast<uint16_t>((buffer[position + 6] << 8) |
+                                               buffer[position + 7]);
+  if (crc16 != crc.final()) {
+    SmlLogger::Error("Transport CRC error: Should be %04x, but is %04x", crc16,
+                     crc.final());
+    return SML_ERROR_CRC;
+  }
+
+  collectListEntries();
+  return SML_OK;
+}
+
+void SmlTape::collectListEntries() {
+  SmlLexer lexer;
+  const int count = static_cast<int>(elements.size());
+
+  // messages: transactionId, groupNo, abortOnError, body, crc, end
+  for (int message = 0; message < count; message = elements[message].next) {
+    const int body = child(message, 3);
+    const int bodyType = child(body, 0);
+    if (bodyType < 0) {
+      continue;
+    }
+
+    size_t position = elements[bodyType].offset;
+    if (lexer.getUnsigned(buffer, buffer_size, position) !=
+        SML_MSG_TYPE_GETLIST_RES) {
+      continue;
+    }
+
+    // GetList.Res: clientId, serverId, listName, actSensorTime, valList, ...
+    const int valList = child(child(body, 1), 4);
+    if (valList < 0) {
+      continue;
+    }
+    int entry = valList + 1;
+    for (uint32_t i = 0; i < elements[valList].length; ++i) {
+      listEntries.push_back(entry);
+      entry = static_cast<int>(elements[entry].next);
+    }
+  }
+}
+
+int SmlTape::child(const int index, const int n) const {
+  if (index < 0 || index >= static_cast<int>(elements.size()) ||
+      elements[index].type != SmlTlType::List || n < 0 ||
+      static_cast<uint32_t>(n) >= elements[index].length) {
+    return -1;
+  }
+
+  int current = index + 1;
+  for (int i = 0; i < n; ++i) {
+    current = static_cast<int>(elements[current].next);
+  }
+  return current;
+}
+
+SmlTapeEntry SmlTape::getListEntry(const size_t n) const {
+  if (n >= listEntries.size()) {
+    return SmlTapeEntry(this, -1);
+  }
+  return SmlTapeEntry(this, listEntries[n]);
+}
+
+SmlTapeEntry SmlTape::getElementByObis(const ObisCode obis) const {
+  for (const int index : listEntries) {
+    SmlTapeEntry entry(this, index);
+    if (entry.obis() == obis) {
+      return entry;
+    }
+  }
+  return SmlTapeEntry(this, -1);
+}
+
+SmlTapeEntry::SmlTapeEntry(const SmlTape *t_tape, const int t_index)
+    : tape{t_tape}, index{t_index} {}
+
+bool SmlTapeEntry::isValid() const { return tape != nullptr && index >= 0; }
+
+int SmlTapeEntry::field(const int n) const {
+  if (!isValid()) {
+    return -1;
+  }
+  return tape->child(index, n);
+}
+
+uint64_t SmlTapeEntry::getNumber(const int n, SmlTlType &type) const {
+  const int element = field(n);
+  type = SmlTlType::Invalid;
+  if (element < 0) {
+    return 0;
+  }
+
+  SmlLexer lexer;
+  type = (*tape)[element].type;
+  size_t position = (*tape)[element].offset;
+  if (type == SmlTlType::Unsigned) {
+    return lexer.getUnsigned(tape->data(), tape->dataSize(), position);
+  }
+  if (type == SmlTlType::Integer) {
+    return static_cast<uint64_t>(
+        lexer.getInteger(tape->data(), tape->dataSize(), position));
+  }
+  return 0;
+}
+
+SmlBytesView SmlTapeEntry::getBytes(const int n) const {
+  const int element = field(n);
+  if (element < 0 || (*tape)[element].type != SmlTlType::OctetString) {
+    return SmlBytesView{};
+  }
+  const SmlTapeElement &el = (*tape)[element];
+  return SmlBytesView{tape->data() + el.offset + el.tlBytes, el.length};
+}
+
+ObisCode SmlTapeEntry::obis() const {
+  return ObisCode::fromBytes(getBytes(ENTRY_OBJ_NAME));
+}
+
+uint64_t SmlTapeEntry::status() const {
+  SmlTlType type;
+  return getNumber(ENTRY_STATUS, type);
+}
+
+uint8_t SmlTapeEntry::unit() const {
+  SmlTlType type;
+  return static_cast<uint8_t>(getNumber(ENTRY_UNIT, type));
+}
+
+int8_t SmlTapeEntry::scaler() const {
+  SmlTlType type;
+  return static_cast<int8_t>(getNumber(ENTRY_SCALER, type));
+}
+
+bool SmlTapeEntry::isString() const { return !sValue().empty(); }
+
+uint64_t SmlTapeEntry::iValue() const {
+  SmlTlType type;
+  return getNumber(ENTRY_VALUE, type);
+}
+
+SmlBytesView SmlTapeEntry::sValue() const { return getBytes(ENTRY_VALUE); }
+
+SmlBytesView SmlTapeEntry::signature() const {
+  return getBytes(ENTRY_SIGNATURE);
+}
+
+double SmlTapeEntry::value() const {
+  SmlTlType type;
+  const uint64_t raw = getNumber(ENTRY_VALUE, type);
+
+  double val = 0.0;
+  if (type == SmlTlType::Unsigned) {
+    val = static_cast<double>(raw);
+  } else if (type == SmlTlType::Integer) {
+    val = static_cast<double>(static_cast<int64_t>(raw));
+  } else {
+    return val;
+  }
+  return val * std::pow(10, scaler());
+}
+
+SmlListEntry SmlTapeEntry::decode() const {
+  SmlListEntry ret;
+  if (!isValid()) {
+    return ret;
+  }
+
+  ret.setObjName(getBytes(ENTRY_OBJ_NAME));
+  ret.setStatus(status());
+  ret.setUnit(unit());
+  ret.setScaler(scaler());
+
+  SmlTlType type;
+  const uint64_t raw = getNumber(ENTRY_VALUE, type);
+  if (type == SmlTlType::Unsigned) {
+    ret.setUnsigned(raw);
+  } else if (type == SmlTlType::Integer) {
+    ret.setInteger(static_cast<int64_t>(raw));
+  } else if (!sValue().empty()) {
+    ret.setBytes(sValue());
+  }
+
+  ret.setSignature(signature());
+  return ret;
+}
@@ -0,0 +1,133 @@
+#ifndef SML_TAPE_HPP
+#define SML_TAPE_HPP
+
+#include "SmlLexer.hpp"
+#include "SmlTypeLength.hpp"
+#include "SmlTypes.hpp"
+#include <stdint.h>
+#include <vector>
+
+/** @brief One element of a frame as recorded by SmlTape::build() */
+struct SmlTapeElement {
+  uint32_t offset; // position of the first TL byte in the frame
+  uint32_t length; // element count for lists, payload bytes otherwise
+  uint32_t next;   // tape index after this element and all its children
+  SmlTlType type;
+  uint8_t tlBytes;
+};
+
+class SmlTape;
+
+/** @brief Lazy handle to a GetList.Res list entry on a tape
+ *
+ *  Nothing is decoded until an accessor is called, and every accessor only
+ *  decodes the fields it returns.
+ */
+class SmlTapeEntry {
+private:
+  const SmlTape *tape;
+  int index;
+
+  int field(const int n) const;
+  uint64_t getNumber(const int n, SmlTlType &type) const;
+  SmlBytesView getBytes(const int n) const;
+
+public:
+  SmlTapeEntry(const SmlTape *t_tape, const int t_index);
+
+  /** @brief Tells whether the handle refers to an entry
+   *  @return false for the result of a failed lookup
+   */
+  bool isValid() const;
+
+  ObisCode obis() const;
+  uint64_t status() const;
+  uint8_t unit() const;
+  int8_t scaler() const;
+  bool isString() const;
+  uint64_t iValue() const;
+  SmlBytesView sValue() const;
+  SmlBytesView signature() const;
+
+  /** @brief Decodes scaler and value
+   *  @return the numeric value with the scaler applied, 0.0 for strings
+   */
+  double value() const;
+
+  /** @brief Decodes all fields
+   *  @return the entry as the DOM parser would have stored it
+   */
+  SmlListEntry decode() const;
+};
+
+/** @brief Structural index of a SML frame (stage 1 of a two-stage parse)
+ *
+ *  build() only walks the TL fields of the frame and records one
+ *  SmlTapeElement per element, no value is decoded. The transport CRC is
+ *  checked in the same pass; message CRCs are not. Fields are decoded later
+ *  (stage 2) when a SmlTapeEntry accessor touches them, so signatures, server
+ *  IDs and time stamps that are never read cost nothing beyond their TL
+ *  bytes. The tape keeps its capacity across frames.
+ */
+class SmlTape {
+private:
+  static const int MAX_DEPTH = 16;
+
+  const unsigned char *buffer{nullptr};
+  size_t buffer_size{0};
+  std::vector<SmlTapeElement> elements;
+  std::vector<int> listEntries;
+
+  void collectListEntries();
+
+public:
+  /** @brief Indexes the first frame in buffer
+   *  @param t_buffer The frame, has to outlive the tape
+   *  @param t_buffer_size Size of the buffer
+   *  @return SML_OK on success
+   *  @return SML_ERROR_SIZE if no complete frame was found
+   *  @return SML_ERROR_SYNTAX on an invalid TL field or end sequence
+   *  @return SML_ERROR_CRC if the transport CRC does not match
+   */
+  sml_error_t build(const unsigned char *t_buffer, const size_t t_buffer_size);
+
+  size_t size() const { return elements.size(); }
+  const SmlTapeElement &operator[](const size_t index) const {
+    return elements[index];
+  }
+  /** @brief Returns the frame, the base of all element offsets */
+  const unsigned char *data() const { return buffer; }
+  size_t dataSize() const { return buffer_size; }
+
+  /** @brief Finds the n-th child of a list
+   *  @param index Tape index of the list
+   *  @param n Number of the child, starting at 0
+   *  @return tape index of the child, -1 if there is no such child
+   */
+  int child(const int index, const int n) const;
+
+  /** @brief Returns the number of GetList.Res entries on the tape */
+  size_t getListEntryCount() const { return listEntries.size(); }
+
+  /** @brief Returns a lazy handle to a GetList.Res entry
+   *  @param n Number of the entry in frame order
+   */
+  SmlTapeEntry getListEntry(const size_t n) const;
+
+  /** @brief Searches a GetList.Res entry, only the names are compared
+   *  @param obis The OBIS to search for
+   *  @return handle to the entry, not valid if obis was not found
+   */
+  SmlTapeEntry getElementByObis(const ObisCode obis) const;
+
+  /** @brief Hands a lazy handle of every GetList.Res entry to a visitor
+   *  @param visitor Object with onListEntry(const SmlTapeEntry &)
+   */
+  template <typename Visitor> void visitListEntries(Visitor &visitor) const {
+    for (const int index : listEntries) {
+      visitor.onListEntry(SmlTapeEntry(this, index));
+    }
+  }
+};
+
+#endif // SML_TAPE_HPP
@@ -0,0 +1,88 @@
+#ifndef SML_TOPIC_MAP_HPP
+#define SML_TOPIC_MAP_HPP
+
+#include "SmlTypes.hpp"
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Maps OBIS codes to topics registered once at initialization
+ *
+ *  Every code is named after itself (see ObisCode::formatName()) and that
+ *  name is registered with a topic registry such as MqttClient, which
+ *  builds the full topic string a single time. Publishing later only looks
+ *  up the topic id, nothing is formatted or allocated then.
+ */
+template <size_t N> class SmlTopicMap {
+public:
+  static constexpr uint16_t NO_TOPIC = 0xffff;
+
+private:
+  struct Entry {
+    ObisCode obis;
+    uint16_t topic;
+    char name[ObisCode::NAME_LENGTH];
+  };
+
+  std::array<Entry, N> entries{};
+  size_t count{0};
+
+  const Entry *findEntry(const ObisCode obis) const {
+    // a handful of codes, a linear search beats anything else
+    for (size_t i = 0; i < count; ++i) {
+      if (entries[i].obis == obis) {
+        return &entries[i];
+      }
+    }
+    return nullptr;
+  }
+
+public:
+  /** @brief Registers the topic of an OBIS code
+   *  @param obis The code
+   *  @param registry Object with uint16_t addTopic(const char *name)
+   *         returning NO_TOPIC on failure, e.g. MqttClient
+   *  @return the topic id, the existing one if obis was added before
+   *  @return NO_TOPIC if obis is invalid, the map is full or the registry
+   *          failed
+   */
+  template <typename Registry>
+  uint16_t add(const ObisCode obis, Registry &registry) {
+    if (const Entry *entry = findEntry(obis)) {
+      return entry->topic;
+    }
+    if (!obis.isValid() || count == N) {
+      return NO_TOPIC;
+    }
+
+    Entry &entry = entries[count];
+    entry.obis = obis;
+    obis.formatName(entry.name);
+    entry.topic = registry.addTopic(entry.name);
+    if (entry.topic == NO_TOPIC) {
+      return NO_TOPIC;
+    }
+    ++count;
+    return entry.topic;
+  }
+
+  /** @brief Returns the topic id of an OBIS code
+   *  @return NO_TOPIC if obis was not added
+   */
+  uint16_t getTopic(const ObisCode obis) const {
+    const Entry *entry = findEntry(obis);
+    return entry != nullptr ? entry->topic : NO_TOPIC;
+  }
+
+  /** @brief Returns the name of an OBIS code, e.g. as payload key
+   *  @return NULL if obis was not added
+   */
+  const char *getName(const ObisCode obis) const {
+    const Entry *entry = findEntry(obis);
+    return entry != nullptr ? entry->name : nullptr;
+  }
+
+  size_t size() const { return count; }
+};
+
+#endif // SML_TOPIC_MAP_HPP
@@ -0,0 +1,89 @@
+#ifndef SML_TYPE_LENGTH_HPP
+#define SML_TYPE_LENGTH_HPP
+
+#include <array>
+#include <stdint.h>
+
+/** @brief Type encoded in bits 6..4 of a SML Type-Length byte */
+enum class SmlTlType : uint8_t {
+  OctetString,
+  Boolean,
+  Integer,
+  Unsigned,
+  List,
+  Invalid
+};
+
+/** @brief Classification of a single SML Type-Length byte
+ *
+ *  length is the low nibble of the TL byte. For scalar types it counts the
+ *  TL byte itself plus the payload, for lists it is the number of elements.
+ *  width is the payload size of Integer/Unsigned types (1..8), 0 otherwise.
+ *  more is set if another TL byte follows (extended length).
+ */
+struct SmlTlInfo {
+  SmlTlType type;
+  uint8_t length;
+  uint8_t width;
+  bool more;
+};
+
+constexpr SmlTlInfo smlMakeTlInfo(const uint8_t tl) {
+  const bool more = (tl & 0x80) != 0;
+  const uint8_t length = tl & 0x0F;
+  SmlTlType type = SmlTlType::Invalid;
+
+  switch ((tl >> 4) & 0x07) {
+  case 0x0:
+    type = SmlTlType::OctetString;
+    break;
+  case 0x4:
+    type = SmlTlType::Boolean;
+    break;
+  case 0x5:
+    type = SmlTlType::Integer;
+    break;
+  case 0x6:
+    type = SmlTlType::Unsigned;
+    break;
+  case 0x7:
+    type = SmlTlType::List;
+    break;
+  }
+
+  uint8_t width = 0;
+  if ((type == SmlTlType::Integer || type == SmlTlType::Unsigned) && !more &&
+      length >= 2 && length <= 9) {
+    width = length - 1;
+  }
+
+  return SmlTlInfo{type, length, width, more};
+}
+
+constexpr std::array<SmlTlInfo, 256> smlMakeTlTable() {
+  std::array<SmlTlInfo, 256> table{};
+  for (int i = 0; i < 256; ++i) {
+    table[i] = smlMakeTlInfo(static_cast<uint8_t>(i));
+  }
+  return table;
+}
+
+/** @brief Lookup table classifying every possible TL byte.
+ *  0x00 (EndOfSmlMsg) is an octet string of length 0.
+ */
+inline constexpr std::array<SmlTlInfo, 256> SML_TL_TABLE = smlMakeTlTable();
+
+static_assert(SML_TL_TABLE[0x62].type == SmlTlType::Unsigned &&
+                  SML_TL_TABLE[0x62].width == 1,
+              "0x62 must be an Unsigned8");
+static_assert(SML_TL_TABLE[0x59].type == SmlTlType::Integer &&
+                  SML_TL_TABLE[0x59].width == 8,
+              "0x59 must be an Integer64");
+static_assert(SML_TL_TABLE[0x77].type == SmlTlType::List &&
+                  SML_TL_TABLE[0x77].length == 7,
+              "0x77 must be a list of 7");
+static_assert(SML_TL_TABLE[0x83].type == SmlTlType::OctetString &&
+                  SML_TL_TABLE[0x83].more,
+              "0x83 must start an extended octet string");
+
+#endif // SML_TYPE_LENGTH_HPP
@@ -2,24 +2,17 @@
 #define SML_TYPES_HPP
 
 #include <stdint.h>
+#include <cstddef>
+#include <cstring>
 #include <string>
 #include <cmath>
+#include <cstdio>
+#include <type_traits>
 
 const uint16_t SML_MSG_TYPE_PUBOPEN_RES = 0x0101;
 const uint16_t SML_MSG_TYPE_GETLIST_RES = 0x0701;
 const uint16_t SML_MSG_TYPE_PUBCLOS_RES = 0x0201;
 
-const std::string OBIS_MANUFACTURER{0x81, 0x81, 0xc7, 0x82, 0x03, 0xff};
-const std::string OBIS_PUB_KEY{0x81, 0x81, 0xc7, 0x82, 0x05, 0xff};
-const std::string OBIS_DEVICE_ID{0x01, 0x00, 0x00, 0x00, 0x09, 0xff};
-const std::string OBIS_TOTAL_ENERGY{0x01, 0x00, 0x01, 0x08, 0x00, 0xff};
-const std::string OBIS_ENERGY_T1{0x01, 0x00, 0x01, 0x08, 0x01, 0xff};
-const std::string OBIS_ENERGY_T2{0x01, 0x00, 0x01, 0x08, 0x02, 0xff};
-const std::string OBIS_SUM_ACT_INST_PWR{0x01, 0x00, 0x10, 0x07, 0x00, 0xff};
-const std::string OBIS_SUM_ACT_INST_PWR_L1{0x01, 0x00, 0x24, 0x07, 0x00, 0xff};
-const std::string OBIS_SUM_ACT_INST_PWR_L2{0x01, 0x00, 0x38, 0x07, 0x00, 0xff};
-const std::string OBIS_SUM_ACT_INST_PWR_L3{0x01, 0x00, 0x4c, 0x07, 0x00, 0xff};
-
 enum sml_error_t {
     SML_OK,
     SML_NOK, 
@@ -29,6 +22,8 @@ enum sml_error_t {
     SML_ERROR_ZEROLENGTH,
     SML_ERROR_SIZE,
     SML_UNKNOWN_TYPE,
+    SML_ERROR_CRC,
+    SML_END_OF_DATA,
 };
 
 enum SmlTimeType {
@@ -38,31 +33,377 @@ enum SmlTimeType {
 };
 
 struct SmlTime {
-    SmlTimeType timeType;
-    uint32_t timeValue;
+    SmlTimeType timeType{secIndex};
+    uint32_t timeValue{0};
+};
+
+/** @brief Non-owning view of an octet string inside the parsed buffer
+ *
+ *  A view only points into the buffer handed to the parser, so it stays valid
+ *  as long as that buffer holds the frame. Call materialize() to keep a copy.
+ */
+struct SmlBytesView {
+    const unsigned char *data{nullptr};
+    size_t length{0};
+
+    bool empty() const { return length == 0; }
+    size_t size() const { return length; }
+    const unsigned char *begin() const { return data; }
+    const unsigned char *end() const { return data + length; }
+    unsigned char operator[](size_t index) const { return data[index]; }
+
+    /** @brief Copies the viewed bytes into an owning string
+     *  @return std::string holding a copy of the octet string
+     */
+    std::string materialize() const {
+        if (empty()) {
+            return std::string();
+        }
+        return std::string(reinterpret_cast<const char *>(data), length);
+    }
+
+    bool operator==(const SmlBytesView &other) const {
+        return length == other.length &&
+               (length == 0 || memcmp(data, other.data, length) == 0);
+    }
+
+    bool operator==(const std::string &other) const {
+        return length == other.size() &&
+               (length == 0 || memcmp(data, other.data(), length) == 0);
+    }
+};
+
+/** @brief OBIS code (A-B:C.D.E*F) packed big-endian into a uint64_t
+ *
+ *  Codes that are not exactly six bytes long are stored as INVALID, which
+ *  can never result from six bytes. Comparing two codes is a single integer
+ *  compare, and since the type is a literal type, codes can be used as
+ *  constants and case labels (switch on packed).
+ */
+struct ObisCode {
+    static constexpr uint64_t INVALID = ~0ULL;
+
+    uint64_t packed{INVALID};
+
+    /** @brief Packs an OBIS code from its six raw bytes
+     *  @param data Pointer to the bytes
+     *  @param length Number of bytes, has to be 6
+     *  @return the packed code, INVALID if length is not 6
+     */
+    static constexpr ObisCode fromBytes(const unsigned char *data,
+                                        const size_t length) {
+        ObisCode code;
+        if (data == nullptr || length != 6) {
+            return code;
+        }
+        code.packed = 0;
+        for (size_t i = 0; i < 6; ++i) {
+            code.packed = (code.packed << 8) | data[i];
+        }
+        return code;
+    }
+
+    static ObisCode fromBytes(const SmlBytesView &bytes) {
+        return fromBytes(bytes.data, bytes.length);
+    }
+
+    static ObisCode fromBytes(const std::string &bytes) {
+        return fromBytes(reinterpret_cast<const unsigned char *>(bytes.data()),
+                         bytes.size());
+    }
+
+    /** @brief Parses the textual form A-B:C.D.E*F
+     *  @param text The code, the group *F is optional and defaults to 255
+     *  @param length Number of characters in text
+     *  @return the packed code, INVALID if the text is malformed
+     */
+    static constexpr ObisCode parse(const char *text, const size_t length) {
+        const char separators[] = {'-', ':', '.', '.', '*'};
+        uint64_t packed = 0;
+        size_t pos = 0;
+
+        for (int group = 0; group < 6; ++group) {
+            if (group == 5 && pos == length) {
+                packed = (packed << 8) | 0xff;
+                break;
+            }
+            if (group > 0) {
+                if (pos >= length || text[pos] != separators[group - 1]) {
+                    return ObisCode{};
+                }
+                ++pos;
+            }
+
+            unsigned int value = 0;
+            size_t digits = 0;
+            while (pos < length && text[pos] >= '0' && text[pos] <= '9' &&
+                   digits < 3) {
+                value = value * 10 + static_cast<unsigned int>(text[pos] - '0');
+                ++pos;
+                ++digits;
+            }
+            if (digits == 0 || value > 0xff) {
+                return ObisCode{};
+            }
+            packed = (packed << 8) | value;
+        }
+
+        if (pos != length) {
+            return ObisCode{};
+        }
+        return ObisCode{packed};
+    }
+
+    /** @brief Formats the code as A-B:C.D.E*F
+     *  @return the textual form, empty if the code is invalid
+     */
+    std::string toString() const {
+        if (!isValid()) {
+            return std::string();
+        }
+        char text[24];
+        snprintf(text, sizeof(text), "%u-%u:%u.%u.%u*%u", byte(0), byte(1),
+                 byte(2), byte(3), byte(4), byte(5));
+        return std::string(text);
+    }
+
+    /** @brief Size of the buffer for formatName() */
+    static constexpr size_t NAME_LENGTH = 24;
+
+    /** @brief Formats the code as name for topics and keys, A-B:C.D.E
+     *  with *F only if F is not 255, e.g. 1-0:1.8.0
+     *  @param out Receives up to NAME_LENGTH characters including the
+     *         terminating NUL, an empty string if the code is invalid
+     *  @return length of the name
+     */
+    size_t formatName(char *out) const {
+        out[0] = '\0';
+        if (!isValid()) {
+            return 0;
+        }
+        const int length =
+            byte(5) == 0xff
+                ? snprintf(out, NAME_LENGTH, "%u-%u:%u.%u.%u", byte(0),
+                           byte(1), byte(2), byte(3), byte(4))
+                : snprintf(out, NAME_LENGTH, "%u-%u:%u.%u.%u*%u", byte(0),
+                           byte(1), byte(2), byte(3), byte(4), byte(5));
+        return static_cast<size_t>(length);
+    }
+
+    /** @brief Returns one group of the code
+     *  @param index 0 for A up to 5 for F
+     *  @return value of the group
+     */
+    constexpr unsigned int byte(const int index) const {
+        return static_cast<unsigned int>((packed >> (8 * (5 - index))) & 0xff);
+    }
+
+    constexpr bool isValid() const { return packed != INVALID; }
+    constexpr bool operator==(const ObisCode &other) const {
+        return packed == other.packed;
+    }
+    constexpr bool operator!=(const ObisCode &other) const {
+        return packed != other.packed;
+    }
+};
+
+static_assert(std::is_trivially_copyable<ObisCode>::value,
+              "ObisCode has to stay a plain integer");
+
+/** @brief Deliberately not constexpr, calling it turns a malformed _obis
+ *  literal into a compile error
+ */
+void sml_invalid_obis_literal();
+
+/** @brief OBIS literal, e.g. "1-0:1.8.0*255"_obis, checked at compile time */
+consteval ObisCode operator""_obis(const char *text, size_t length) {
+    const ObisCode code = ObisCode::parse(text, length);
+    if (!code.isValid()) {
+        sml_invalid_obis_literal();
+    }
+    return code;
+}
+
+inline constexpr ObisCode OBIS_MANUFACTURER = "129-129:199.130.3*255"_obis;
+inline constexpr ObisCode OBIS_PUB_KEY = "129-129:199.130.5*255"_obis;
+inline constexpr ObisCode OBIS_DEVICE_ID = "1-0:0.0.9*255"_obis;
+inline constexpr ObisCode OBIS_TOTAL_ENERGY = "1-0:1.8.0*255"_obis;
+inline constexpr ObisCode OBIS_ENERGY_T1 = "1-0:1.8.1*255"_obis;
+inline constexpr ObisCode OBIS_ENERGY_T2 = "1-0:1.8.2*255"_obis;
+inline constexpr ObisCode OBIS_SUM_ACT_INST_PWR = "1-0:16.7.0*255"_obis;
+inline constexpr ObisCode OBIS_SUM_ACT_INST_PWR_L1 = "1-0:36.7.0*255"_obis;
+inline constexpr ObisCode OBIS_SUM_ACT_INST_PWR_L2 = "1-0:56.7.0*255"_obis;
+inline constexpr ObisCode OBIS_SUM_ACT_INST_PWR_L3 = "1-0:76.7.0*255"_obis;
+
+static_assert(OBIS_TOTAL_ENERGY.packed == 0x0100010800ffULL,
+              "OBIS literals have to pack big-endian");
+static_assert(OBIS_MANUFACTURER.packed == 0x8181c78203ffULL,
+              "OBIS literals have to pack big-endian");
+static_assert("1-0:1.8.0"_obis == OBIS_TOTAL_ENERGY,
+              "the *F group defaults to 255");
+
+/** @brief Kind of value held by a SmlListEntry */
+enum class SmlValueType : uint8_t {
+    None,
+    Unsigned,
+    Integer,
+    Bytes
 };
 
-struct SmlListEntry {
-    std::string objName;
-    uint64_t status;
-    SmlTime valTime;
-    uint8_t unit;
-    int8_t scaler{0};
-    bool isString;
-    uint64_t iValue;
-    std::string sValue;
-    std::string signature;
-
-    double value() {
-        double val=0.0f;
-
-        if(!isString) {
-            val = static_cast<double>(iValue);
-            val *= std::pow(10, scaler);
+/** @brief One entry of a GetList.Res value list
+ *
+ *  The entry is packed for fast iteration over valList: the OBIS code is
+ *  stored inline, the value is a tagged union of uint64/int64/bytes view and
+ *  unit, scaler, time type and the lengths share a few bytes. That gives 40
+ *  bytes on the ESP32 instead of three strings per entry. Octet string values
+ *  and the signature point into the parsed buffer, see SmlBytesView. All
+ *  members are read through the accessors below.
+ */
+class SmlListEntry {
+private:
+    uint8_t name[6]{};
+    uint8_t nameLength{0};
+    SmlValueType valueType{SmlValueType::None};
+    uint8_t unitCode{0};
+    int8_t scalerValue{0};
+    uint8_t timeType{SmlTimeType::secIndex};
+    uint16_t valueLength{0};
+    uint16_t signatureLength{0};
+    uint32_t timeValue{0};
+    const unsigned char *signatureData{nullptr};
+    uint64_t statusWord{0};
+    union {
+        uint64_t bits;
+        const unsigned char *data;
+    } payload{0};
+
+public:
+    /** @brief Stores the objName inline
+     *  @param bytes The objName, only six byte OBIS codes are kept
+     *  @return false if the name is not a six byte OBIS code
+     */
+    bool setObjName(const SmlBytesView &bytes) {
+        if (bytes.length != sizeof(name)) {
+            nameLength = 0;
+            return false;
         }
+        memcpy(name, bytes.data, sizeof(name));
+        nameLength = sizeof(name);
+        return true;
+    }
+
+    void setStatus(const uint64_t status) { statusWord = status; }
+    void setValTime(const SmlTime &time) {
+        timeType = static_cast<uint8_t>(time.timeType);
+        timeValue = time.timeValue;
+    }
+    void setUnit(const uint8_t unit) { unitCode = unit; }
+    void setScaler(const int8_t scaler) { scalerValue = scaler; }
+
+    void setUnsigned(const uint64_t value) {
+        valueType = SmlValueType::Unsigned;
+        payload.bits = value;
+    }
 
-        return val;
+    void setInteger(const int64_t value) {
+        valueType = SmlValueType::Integer;
+        payload.bits = static_cast<uint64_t>(value);
+    }
+
+    /** @brief Stores an octet string value
+     *  @param bytes View into the parsed buffer
+     *  @return false if it is longer than 65535 bytes, the entry then has no
+     *          value
+     */
+    bool setBytes(const SmlBytesView &bytes) {
+        if (bytes.length > UINT16_MAX) {
+            valueType = SmlValueType::None;
+            valueLength = 0;
+            return false;
+        }
+        valueType = SmlValueType::Bytes;
+        payload.data = bytes.data;
+        valueLength = static_cast<uint16_t>(bytes.length);
+        return true;
+    }
+
+    /** @brief Stores the valueSignature
+     *  @param bytes View into the parsed buffer
+     *  @return false if it is longer than 65535 bytes, the entry then has no
+     *          signature
+     */
+    bool setSignature(const SmlBytesView &bytes) {
+        if (bytes.length > UINT16_MAX) {
+            signatureData = nullptr;
+            signatureLength = 0;
+            return false;
+        }
+        signatureData = bytes.data;
+        signatureLength = static_cast<uint16_t>(bytes.length);
+        return true;
+    }
+
+    /** @brief Returns the objName
+     *  @return view of the inline OBIS bytes, empty if the entry has none
+     */
+    SmlBytesView objName() const { return SmlBytesView{name, nameLength}; }
+
+    /** @brief Returns the objName as packed OBIS code
+     *  @return the code, ObisCode::INVALID if the entry has no name
+     */
+    ObisCode obis() const { return ObisCode::fromBytes(name, nameLength); }
+
+    uint64_t status() const { return statusWord; }
+    SmlTime valTime() const {
+        return SmlTime{static_cast<SmlTimeType>(timeType), timeValue};
+    }
+    uint8_t unit() const { return unitCode; }
+    int8_t scaler() const { return scalerValue; }
+
+    SmlValueType type() const { return valueType; }
+    bool isString() const { return valueType == SmlValueType::Bytes; }
+    bool isSigned() const { return valueType == SmlValueType::Integer; }
+
+    /** @brief Returns the raw integer value without scaler
+     *  @return the value, Integer values as two's complement, 0 for strings
+     */
+    uint64_t iValue() const { return isString() ? 0 : payload.bits; }
+
+    /** @brief Returns an octet string value
+     *  @return view into the parsed buffer, empty for numeric values
+     */
+    SmlBytesView sValue() const {
+        if (!isString()) {
+            return SmlBytesView{};
+        }
+        return SmlBytesView{payload.data, valueLength};
+    }
+
+    SmlBytesView signature() const {
+        return SmlBytesView{signatureData, signatureLength};
+    }
+
+    /** @brief Returns the numeric value with the scaler applied
+     *  @return the value, 0.0 for strings and entries without value
+     */
+    double value() const {
+        double val = 0.0;
+
+        if (valueType == SmlValueType::Unsigned) {
+            val = static_cast<double>(payload.bits);
+        } else if (valueType == SmlValueType::Integer) {
+            val = static_cast<double>(static_cast<int64_t>(payload.bits));
+        } else {
+            return val;
+        }
+
+        return val * std::pow(10, scalerValue);
     }
 };
 
+/** @brief A list entry as handed to visitors. It is a plain value, but its
+ *  octet strings point into the parsed buffer like all SmlBytesViews.
+ */
+using SmlListEntryView = SmlListEntry;
+
 #endif // SML_TYPES_HPP
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef SML_VARINT_HPP
+#define SML_VARINT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Largest encoding of a 64 bit value by sml_varint_encode() */
+const size_t SML_VARINT_MAX_LENGTH = 10;
+
+/** @brief Maps signed to unsigned values so that small magnitudes stay small
+ *  (0, -1, 1, -2, ... become 0, 1, 2, 3, ...)
+ */
+inline uint64_t sml_zigzag_encode(const int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+/** @brief Inverse of sml_zigzag_encode() */
+inline int64_t sml_zigzag_decode(const uint64_t value) {
+  return static_cast<int64_t>((value >> 1) ^ (0 - (value & 1)));
+}
+
+/** @brief Writes an unsigned LEB128 varint, 7 bits per byte
+ *  @param value The value to encode
+ *  @param out Receives up to SML_VARINT_MAX_LENGTH bytes
+ *  @return number of bytes written
+ */
+inline size_t sml_varint_encode(uint64_t value, uint8_t *out) {
+  size_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+  out[length++] = static_cast<uint8_t>(value);
+  return length;
+}
+
+/** @brief Reads an unsigned LEB128 varint
+ *  @param data The encoded bytes
+ *  @param size Size of data
+ *  @param position Position of the first byte, advanced past the varint
+ *  @param value Receives the decoded value
+ *  @return true on success
+ *  @return false if the varint is truncated or longer than 64 bits,
+ *  position is left unchanged then
+ */
+inline bool sml_varint_decode(const uint8_t *data, const size_t size,
+                              size_t &position, uint64_t &value) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < SML_VARINT_MAX_LENGTH && position + i < size; ++i) {
+    const uint8_t byte = data[position + i];
+    result |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+    if ((byte & 0x80) == 0) {
+      position += i + 1;
+      value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+/** @brief Turns a series into delta-of-delta residuals and back
+ *
+ *  The first value is passed through, the second one becomes its delta and
+ *  every further one the change of the delta. Counters growing at a steady
+ *  rate and regular time stamps thus yield residuals around 0, which
+ *  zig-zag varints store in a single byte. Arithmetic wraps modulo 2^64, so
+ *  every int64_t series round-trips.
+ */
+class SmlDeltaOfDelta {
+private:
+  uint64_t previous{0};
+  uint64_t previousDelta{0};
+  uint32_t count{0};
+
+public:
+  /** @brief Starts a new series */
+  void reset() {
+    previous = 0;
+    previousDelta = 0;
+    count = 0;
+  }
+
+  /** @brief Returns the residual of the next value of the series */
+  int64_t encode(const int64_t value) {
+    const uint64_t current = static_cast<uint64_t>(value);
+    const uint64_t delta = current - previous;
+    const uint64_t residual = count == 0   ? current
+                              : count == 1 ? delta
+                                           : delta - previousDelta;
+    previous = current;
+    previousDelta = delta;
+    if (count < 2) {
+      ++count;
+    }
+    return static_cast<int64_t>(residual);
+  }
+
+  /** @brief Returns the next value of the series from its residual */
+  int64_t decode(const int64_t residual) {
+    const uint64_t r = static_cast<uint64_t>(residual);
+    const uint64_t delta = count == 0   ? r - previous
+                           : count == 1 ? r
+                                        : previousDelta + r;
+    previous += delta;
+    previousDelta = delta;
+    if (count < 2) {
+      ++count;
+    }
+    return static_cast<int64_t>(previous);
+  }
+};
+
+#endif // SML_VARINT_HPP
@@ -1,8 +1,14 @@
 #include "MqttClient.hpp"
+#include "SmlHistory.hpp"
 #include "SmlLexer.hpp"
 #include "SmlParser.hpp"
+#include "SmlPayload.hpp"
+#include "SmlPublishPolicy.hpp"
+#include "SmlStreamParser.hpp"
+#include "SmlTopicMap.hpp"
 #include "Wifi.hpp"
 #include <driver/uart.h>
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "esp_sleep.h"
 #include <freertos/FreeRTOS.h>
@@ -12,6 +18,7 @@
 #include "nvs_flash.h"
 #include <cstring>
 #include <iostream>
+#include <iterator>
 #include "myconfig.hpp"
 
 const char *TAG = "main";
@@ -41,8 +48,28 @@ const uint8_t UART_RX_FLW_CTRL_THRSHLD = 122;
 const uart_sclk_t UART_SRC_CLK = UART_SCLK_DEFAULT;
 const uint16_t UART_TIMEOUT_MS = 1000;
 const uint32_t UART_RX_BUF_SIZE = 512;
+const uint32_t SML_FRAME_BUF_SIZE = 1024;
+const uint32_t SML_ARENA_SIZE = 1024;
+const uint32_t SML_HISTORY_SIZE = 1024;
+const uint32_t SML_PAYLOAD_SIZE = 256;
 const uint8_t UART_PATTERN_CHR_NUM = 1;
 
+/* MQTT Config */
+// true: all readings of a frame as one JSON document to <id>/readings,
+// false: every reading on its own to <id>/<OBIS code>, e.g. sml_reader/1-0:1.8.0
+const bool MQTT_BATCH_READINGS = true;
+// readings published while the broker is unreachable wait in a queue of this
+// many messages and go out at a limited rate once it is back. The queue is in
+// RAM and lost at deep sleep, so it only bridges the drain window before
+// sleeping; longer outages are covered by the histories in RTC memory
+const size_t MQTT_QUEUE_LENGTH = 16;
+const uint16_t MQTT_DRAIN_RATE = 5;
+const uint16_t MQTT_DRAIN_BURST = 4;
+const int MQTT_DRAIN_TIMEOUT_MS = 5000;
+// readings recorded while the broker was unreachable are sent from the
+// histories to <id>/history, at most this many per history and wake-up
+const size_t MQTT_HISTORY_BACKFILL = 8;
+
 QueueHandle_t uart_queue = NULL;
 
 uart_event_t event;
@@ -59,7 +86,30 @@ void app_main()
     }
     ESP_ERROR_CHECK(ret);
 	
-	char compute_buffer[UART_RX_BUF_SIZE];
+	static unsigned char uart_chunk[UART_RX_BUF_SIZE];
+	static unsigned char frame_buffer[SML_FRAME_BUF_SIZE];
+	static char payload_buffer[SML_PAYLOAD_SIZE];
+	alignas(std::max_align_t) static unsigned char arena_buffer[SML_ARENA_SIZE];
+	static SmlArena smlArena(arena_buffer, sizeof(arena_buffer));
+	// RTC memory survives deep sleep, so the histories span many wake-ups
+	alignas(std::max_align_t) static RTC_DATA_ATTR unsigned char energy_history[SML_HISTORY_SIZE];
+	alignas(std::max_align_t) static RTC_DATA_ATTR unsigned char power_history[SML_HISTORY_SIZE];
+	SmlHistory energyHistory(energy_history, sizeof(energy_history), OBIS_TOTAL_ENERGY);
+	SmlHistory powerHistory(power_history, sizeof(power_history), OBIS_SUM_ACT_INST_PWR);
+	SmlHistory *const histories[] = {&energyHistory, &powerHistory};
+	// newest actSensorTime known to have reached the broker, later samples are sent again
+	static RTC_DATA_ATTR uint32_t history_sent_until = 0;
+	// publish a reading once it leaves its deadband, and at least once an hour
+	static constexpr SmlDeadband deadbands[] = {
+		{OBIS_TOTAL_ENERGY, 10.0, 0.0, 3600},
+		{OBIS_SUM_ACT_INST_PWR, 10.0, 0.05, 3600},
+		{OBIS_SUM_ACT_INST_PWR_L1, 10.0, 0.05, 3600},
+		{OBIS_SUM_ACT_INST_PWR_L2, 10.0, 0.05, 3600},
+		{OBIS_SUM_ACT_INST_PWR_L3, 10.0, 0.05, 3600},
+	};
+	static RTC_DATA_ATTR SmlPublishState publish_states[std::size(deadbands)];
+	SmlPublishPolicy publishPolicy(deadbands, publish_states);
+	SmlPayloadWriter payload(payload_buffer, sizeof(payload_buffer), SmlPayloadFormat::Json);
 
 	/* UART */
 	uart_config_t uart_config = {
@@ -87,34 +137,78 @@ void app_main()
 	}
 
 	MqttClient mqtt = MqttClient("sml_reader");
-	mqtt.initialize(mqtt_host, 1883, mqtt_user, mqtt_pwd);
-	mqtt.start();
+	// batches of one topic must not replace each other, single readings only need the latest value
+	mqtt.setOfflineQueue(MQTT_QUEUE_LENGTH, MQTT_BATCH_READINGS ? SML_PAYLOAD_SIZE : SML_DECIMAL_MAX_LENGTH,
+		MQTT_BATCH_READINGS ? MqttClient::QueuePolicy::DropOldest : MqttClient::QueuePolicy::CoalesceByTopic);
+	mqtt.setDrainRate(MQTT_DRAIN_RATE, MQTT_DRAIN_BURST);
+
+	SmlStreamParser smlStream(frame_buffer, SML_FRAME_BUF_SIZE, &smlArena);
+	SmlParser &smlParser = smlStream.getParser();
+	// only decode what is printed or published below, signatures etc. are skipped
+	static constexpr SmlObisSet wantedObis{
+		OBIS_MANUFACTURER,
+		OBIS_TOTAL_ENERGY,
+		OBIS_SUM_ACT_INST_PWR,
+		OBIS_SUM_ACT_INST_PWR_L1,
+		OBIS_SUM_ACT_INST_PWR_L2,
+		OBIS_SUM_ACT_INST_PWR_L3,
+	};
+	smlParser.setObisFilter(wantedObis);
 
-	SmlParser smlParser(reinterpret_cast<unsigned char *>(&compute_buffer), int(UART_RX_BUF_SIZE));
+	static constexpr ObisCode publishedCodes[] = {
+		OBIS_TOTAL_ENERGY,
+		OBIS_SUM_ACT_INST_PWR,
+		OBIS_SUM_ACT_INST_PWR_L1,
+		OBIS_SUM_ACT_INST_PWR_L2,
+		OBIS_SUM_ACT_INST_PWR_L3,
+	};
+	// topics and payload keys are named after the OBIS codes, the full topic
+	// strings are built once here and publishing allocates nothing
+	static_assert(SmlTopicMap<1>::NO_TOPIC == MqttClient::INVALID_TOPIC);
+	SmlTopicMap<std::size(publishedCodes)> obisTopics;
+	for (const ObisCode code : publishedCodes) {
+		obisTopics.add(code, mqtt);
+	}
+	const TopicId readingsTopic = mqtt.addTopic("readings");
+	const TopicId historyTopic = mqtt.addTopic("history");
+	// the topics are fixed from here on, initialize() also starts the client
+	mqtt.initialize(mqtt_host, 1883, mqtt_user, mqtt_pwd);
+	bool frameComplete = false;
+	smlStream.setFrameHandler([&frameComplete](SmlParser &) { frameComplete = true; });
 
 	for (;;)
 	{
-		bzero(&compute_buffer, UART_RX_BUF_SIZE);
 		if (xQueueReceive(uart_queue, (void *)&event, (TickType_t)UART_TIMEOUT_MS / portTICK_PERIOD_MS))
 		{
 			ESP_LOGV(TAG2, "[Core1]\treceived an uart event\n");
 			switch (event.type)
 			{
 			case UART_DATA:
-				uart_read_bytes(UART_PORT, &compute_buffer, UART_RX_BUF_SIZE, UART_TIMEOUT_MS / portTICK_PERIOD_MS);
-				uart_flush_input(UART_PORT);
-				// printf("%02x%02x receoived\n", compute_buffer[0], compute_buffer[1]);
+			{
+				// feed whatever arrived, frames may span several reads
+				size_t to_read = event.size < UART_RX_BUF_SIZE ? event.size : UART_RX_BUF_SIZE;
+				int received = uart_read_bytes(UART_PORT, uart_chunk, to_read, UART_TIMEOUT_MS / portTICK_PERIOD_MS);
+				if (received > 0)
+				{
+					// stop behind a complete frame, a following start sequence would
+					// drop its results. The rest of the chunk is not needed before sleeping.
+					size_t consumed = 0;
+					smlStream.feed(uart_chunk, size_t(received), consumed);
+				}
 				break;
+			}
 			case UART_FIFO_OVF:
 				ESP_LOGI(TAG2, "hw fifo overflow");
 				uart_flush_input(UART_PORT);
 				xQueueReset(uart_queue);
+				smlStream.reset();
 				break;
 			// Event of UART ring buffer full
 			case UART_BUFFER_FULL:
 				ESP_LOGI(TAG2, "ring buffer full");
 				uart_flush_input(UART_PORT);
 				xQueueReset(uart_queue);
+				smlStream.reset();
 				break;
 			// Event of UART RX break detected
 			case UART_BREAK:
@@ -154,22 +248,23 @@ void app_main()
 			}
 		}
 
-		// parse the SMl message
-		if( smlParser.parseSml() != SML_OK) {
+		// wait until the stream parser has seen a complete SML frame
+		if (!frameComplete) {
 			continue;
 		}
+		frameComplete = false;
 
-		SmlListEntry manufacturer = smlParser.getElementByObis(OBIS_MANUFACTURER);
+		const SmlListEntry &manufacturer = smlParser.getElementByObis(OBIS_MANUFACTURER);
 
-		if (manufacturer.objName.empty())
+		if (manufacturer.objName().empty())
 		{
 			ESP_LOGW(TAG1, "No manufacturer found");
 		}
 		else
 		{
-			if (manufacturer.isString)
+			if (manufacturer.isString())
 			{
-				std::cout << "Manufacturer: " << std::hex << manufacturer.sValue << "\n";
+				std::cout << "Manufacturer: " << manufacturer.sValue().materialize() << "\n";
 			}
 			else
 			{
@@ -177,33 +272,142 @@ void app_main()
 			}
 		}
 
-		SmlListEntry totalEnergy = smlParser.getElementByObis(OBIS_TOTAL_ENERGY);
+		// resolve all published values with a single index pass
+		const SmlListEntry *published[std::size(publishedCodes)];
+		smlParser.getElementsByObis(publishedCodes, published);
+
+		const SmlListEntry empty{};
+		const SmlListEntry &totalEnergy = published[0] ? *published[0] : empty;
+		const SmlListEntry &sumPower = published[1] ? *published[1] : empty;
+
+		const uint32_t sensorTime = smlParser.getSensorTime().timeValue;
+		energyHistory.append(sensorTime, totalEnergy);
+		powerHistory.append(sensorTime, sumPower);
+		ESP_LOGI(TAG1, "history: %u energy, %u power samples", unsigned(energyHistory.size()), unsigned(powerHistory.size()));
+
 		std::cout << "totalEnergy: \nvalue:\t" << std::dec << totalEnergy.value() << '\n';
-		std::cout << "iValue: " << totalEnergy.iValue << " " << smlParser.getUnitAsString(totalEnergy.unit) << '\n';
+		std::cout << "iValue: " << totalEnergy.iValue() << " " << smlParser.getUnitAsString(totalEnergy.unit()) << '\n';
 
-		SmlListEntry powerL1 = smlParser.getElementByObis(OBIS_SUM_ACT_INST_PWR);
-		std::cout << "\nValue " << std::hex << powerL1.iValue << '\n';
-		std::cout << "scaler " << std::hex << powerL1.scaler << '\n';
-		std::cout << "Integer:: sum actual instantanious power: " << powerL1.value() << " " << smlParser.getUnitAsString(powerL1.unit) << "\n";
+		std::cout << "\nValue " << std::hex << sumPower.iValue() << '\n';
+		std::cout << "scaler " << std::hex << static_cast<int>(sumPower.scaler()) << '\n';
+		std::cout << "Integer:: sum actual instantanious power: " << sumPower.value() << " " << smlParser.getUnitAsString(sumPower.unit()) << "\n";
 
+		// only readings that changed enough are sent, the others and failed ones stay
+		// due and are retried with the next frame
+		const SmlListEntry *due[std::size(publishedCodes)];
+		size_t dueCount = 0;
+		auto selectIfDue = [&](const SmlListEntry &entry) {
+			if (obisTopics.getName(entry.obis()) != nullptr && publishPolicy.isDue(entry, sensorTime)) {
+				due[dueCount++] = &entry;
+			}
+		};
 		if(totalEnergy.value() > 0) {
-			mqtt.publish("totalEnergy", std::to_string(totalEnergy.value()));
+			selectIfDue(totalEnergy);
 		}
-		if(smlParser.getElementByObis(OBIS_SUM_ACT_INST_PWR).value() < 22000000) {
-			mqtt.publish("sumInstantPower", std::to_string(smlParser.getElementByObis(OBIS_SUM_ACT_INST_PWR).value()));
-		}
-		if(smlParser.getElementByObis(OBIS_SUM_ACT_INST_PWR).value() < 22000000) {
-			mqtt.publish("instantPowerL1", std::to_string(smlParser.getElementByObis(OBIS_SUM_ACT_INST_PWR_L1).value()));
+		const double sumPowerValue = sumPower.value();
+		if(sumPowerValue < 22000000) {
+			for (size_t i = 1; i < std::size(publishedCodes); ++i) {
+				if (published[i]) {
+					selectIfDue(*published[i]);
+				}
+			}
 		}
-		if(smlParser.getElementByObis(OBIS_SUM_ACT_INST_PWR).value() < 22000000) {
-			mqtt.publish("instantPowerL2", std::to_string(smlParser.getElementByObis(OBIS_SUM_ACT_INST_PWR_L2).value()));
+
+		// the publish state survives deep sleep, the offline queue does not: queued
+		// readings only count as published once the queue went out completely
+		const SmlListEntry *queued[std::size(publishedCodes)];
+		size_t queuedCount = 0;
+		auto record = [&](const SmlListEntry &entry, const esp_err_t result) {
+			if (result == ESP_OK) {
+				publishPolicy.setPublished(entry, sensorTime);
+			} else if (result == ESP_ERR_NOT_FINISHED) {
+				queued[queuedCount++] = &entry;
+			}
+		};
+		if (MQTT_BATCH_READINGS) {
+			const SmlListEntry *batch[std::size(publishedCodes)];
+			size_t batchCount = 0;
+			payload.begin(sensorTime);
+			for (size_t i = 0; i < dueCount; ++i) {
+				if (payload.add(obisTopics.getName(due[i]->obis()), *due[i])) {
+					batch[batchCount++] = due[i];
+				}
+			}
+			if (batchCount > 0 && payload.finish()) {
+				const esp_err_t result = mqtt.publish(readingsTopic, payload.data(), payload.size());
+				for (size_t i = 0; i < batchCount; ++i) {
+					record(*batch[i], result);
+				}
+			}
+		} else {
+			for (size_t i = 0; i < dueCount; ++i) {
+				char text[SML_DECIMAL_MAX_LENGTH];
+				const size_t length = sml_format_value(*due[i], text);
+				record(*due[i], mqtt.publish(obisTopics.getTopic(due[i]->obis()), text, length));
+			}
 		}
-		if(smlParser.getElementByObis(OBIS_SUM_ACT_INST_PWR).value() < 22000000) {
-			mqtt.publish("instantPowerL3", std::to_string(smlParser.getElementByObis(OBIS_SUM_ACT_INST_PWR_L3).value()));
+
+		// back online: send what the histories recorded since the broker was last
+		// reached, one document per time stamp like the batched readings
+		uint32_t sentUntil = history_sent_until;
+		if (mqtt.isConnected() && sensorTime > 0) {
+			// a restarted meter counts its seconds from zero again
+			const uint32_t from = history_sent_until < sensorTime ? history_sent_until + 1 : 0;
+			sentUntil = sensorTime;
+			SmlHistorySample samples[std::size(histories)][MQTT_HISTORY_BACKFILL];
+			size_t counts[std::size(histories)];
+			size_t next[std::size(histories)] = {};
+			uint32_t until = sensorTime - 1;
+			for (size_t h = 0; h < std::size(histories); ++h) {
+				counts[h] = histories[h]->getRange(from, until, samples[h]);
+				// a full buffer may have cut the range, the rest follows next time
+				if (counts[h] == MQTT_HISTORY_BACKFILL) {
+					until = samples[h][counts[h] - 1].time;
+					sentUntil = until;
+				}
+			}
+			for (;;) {
+				uint32_t time = until + 1;
+				for (size_t h = 0; h < std::size(histories); ++h) {
+					if (next[h] < counts[h] && samples[h][next[h]].time < time) {
+						time = samples[h][next[h]].time;
+					}
+				}
+				if (time > until) {
+					break;
+				}
+				payload.begin(time);
+				for (size_t h = 0; h < std::size(histories); ++h) {
+					if (next[h] < counts[h] && samples[h][next[h]].time == time) {
+						const int64_t value = samples[h][next[h]++].value;
+						const uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+						payload.add(obisTopics.getName(histories[h]->getObis()), magnitude, value < 0, histories[h]->getScaler());
+					}
+				}
+				if (payload.finish()) {
+					mqtt.publish(historyTopic, payload.data(), payload.size());
+				}
+			}
 		}
-		
+
 		vTaskDelay(2000 / portTICK_PERIOD_MS);
 
+		// the queue is lost in deep sleep: whatever did not drain within
+		// MQTT_DRAIN_TIMEOUT_MS is dropped, its readings stay due and in the histories
+		for (int waited = 0; mqtt.getQueuedCount() > 0 && waited < MQTT_DRAIN_TIMEOUT_MS; waited += 100) {
+			mqtt.drain();
+			vTaskDelay(100 / portTICK_PERIOD_MS);
+		}
+		if (mqtt.getQueuedCount() > 0 || mqtt.getDroppedCount() > 0 || mqtt.getCoalescedCount() > 0) {
+			ESP_LOGW(TAG1, "%u messages not sent, %u dropped, %u replaced by newer ones", unsigned(mqtt.getQueuedCount()),
+				unsigned(mqtt.getDroppedCount()), unsigned(mqtt.getCoalescedCount()));
+		} else {
+			for (size_t i = 0; i < queuedCount; ++i) {
+				publishPolicy.setPublished(*queued[i], sensorTime);
+			}
+			history_sent_until = sentUntil;
+		}
+
 		// wifi.disconnect();
 		const int wakeup_time_sec = 5 * 60;
 		ESP_ERROR_CHECK(esp_sleep_enable_timer_wakeup(wakeup_time_sec * 1000000));
@@ -1,232 +1,1483 @@
 #include <gtest/gtest.h>
+#include "SmlBulkParser.hpp"
+#include "SmlColumnStore.hpp"
+#include "SmlCrc.hpp"
+#include "SmlFrameSync.hpp"
+#include "SmlHistory.hpp"
+#include "SmlObisIndex.hpp"
 #include "SmlParser.hpp"
+#include "SmlPayload.hpp"
+#include "SmlPublishPolicy.hpp"
+#include "SmlStreamParser.hpp"
+#include "SmlTape.hpp"
+#include "SmlTopicMap.hpp"
+#include "SmlVarint.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <stdexcept>
 #include <stdint.h>
+#include <string>
+#include <vector>
 
 SmlLogLevel SmlLogger::logLevel{SmlLogLevel::Debug};
 
 TEST(isOctetString, noString) {
-    EXPECT_FALSE(isOctetString(0x10));
+    SmlLexer lexer;
+    EXPECT_FALSE(lexer.isOctetString(0x10));
+    EXPECT_FALSE(lexer.isOctetString(0x83));
 }
 
 TEST(isOctetString, isString) {
-    EXPECT_TRUE(isOctetString(0x0C));
+    SmlLexer lexer;
+    EXPECT_TRUE(lexer.isOctetString(0x0C));
+    EXPECT_TRUE(lexer.isExtendedOctetString(0x83));
 }
 
 TEST(getOctetStringLength, wrongLength) {
-    EXPECT_EQ(getOctetStringLength(0x11), -1);
-    EXPECT_EQ(getOctetStringLength(0x10), -1);
-    EXPECT_EQ(getOctetStringLength(0xFF), -1);
+    SmlLexer lexer;
+    EXPECT_EQ(lexer.getOctetStringLength(0x11), -2);
+    EXPECT_EQ(lexer.getOctetStringLength(0x10), -2);
+    EXPECT_EQ(lexer.getOctetStringLength(0xFF), -2);
 }
 
 TEST(getOctetStringLength, zeroLength) {
-    EXPECT_EQ(getOctetStringLength(0x00), 0);
+    SmlLexer lexer;
+    EXPECT_EQ(lexer.getOctetStringLength(0x00), -1);
 }
 
 TEST(getExtendedOctetStringLength, extendedLength) {
+    SmlLexer lexer;
+    // the length in the TL field includes the TL bytes themselves
     std::vector<unsigned char> v = {0x83, 0x02};
-    int position = 0;
-    EXPECT_EQ(getExtendedOctetStringLength(&v, position), 0x32);
+    size_t position = 0;
+    EXPECT_EQ(lexer.getExtendedOctetStringLength(v.data(), v.size(), position), 0x30);
+    EXPECT_EQ(position, 2);
 
     v = {0x83, 0x81, 0x02};
     position = 0;
-    EXPECT_EQ(getExtendedOctetStringLength(&v, position), 0x312);
+    EXPECT_EQ(lexer.getExtendedOctetStringLength(v.data(), v.size(), position), 0x30F);
+    EXPECT_EQ(position, 3);
+
+    v = {0x83, 0x81};
+    position = 0;
+    EXPECT_EQ(lexer.getExtendedOctetStringLength(v.data(), v.size(), position), -3);
 }
 
 TEST(getOctetStringLength, normalLength) {
-    EXPECT_EQ(getOctetStringLength(0x01), 0x00);
-    EXPECT_EQ(getOctetStringLength(0x0F), 0x0E);
+    SmlLexer lexer;
+    EXPECT_EQ(lexer.getOctetStringLength(0x01), 0x00);
+    EXPECT_EQ(lexer.getOctetStringLength(0x0F), 0x0E);
 }
 
-TEST(getOctetStringAsVector, detectNullptr) {
-    std::vector<unsigned char> w;
-    std::vector<unsigned char> v;
-    EXPECT_EQ(getOctetStringAsVector(NULL, 1, &w, 1), SML_ERROR_NULLPTR);
-    EXPECT_EQ(getOctetStringAsVector(&v, 1, NULL, 1), SML_ERROR_NULLPTR);
+TEST(getOctetString, detectNullptr) {
+    SmlLexer lexer;
+    size_t position = 1;
+    EXPECT_TRUE(lexer.getOctetString(nullptr, 2, position, 1).empty());
 }
 
-TEST(getOctetStringAsVector, zeroLength) {
-    std::vector<unsigned char> w;
-    std::vector<unsigned char> v;
-    EXPECT_EQ(getOctetStringAsVector(&v, 1, &w, 0), SML_ERROR_ZEROLENGTH);
+TEST(getOctetString, zeroLength) {
+    SmlLexer lexer;
+    std::vector<unsigned char> v = {0x01};
+    size_t position = 1;
+    EXPECT_TRUE(lexer.getOctetString(v.data(), v.size(), position, 0).empty());
 }
 
-TEST(getOctetStringAsVector, bufferOverflow) {
-    std::vector<unsigned char> w;
+TEST(getOctetString, bufferOverflow) {
+    SmlLexer lexer;
     std::vector<unsigned char> v = {0x66};
-    EXPECT_EQ(getOctetStringAsVector(&v, 1, &w, 10), SML_ERROR_SIZE);
-}
-
-TEST(getExtendedOctetStringAsVector, getExtendedOctetStringAsVector) {
-  int position = 0;
-  std::vector<unsigned char> w;
-  std::vector<unsigned char> v = {0x81, 0x04, 0x74, 0x68, 0x69, 0x73, 0x20,
-                                  0x69, 0x73, 0x20, 0x61, 0x20, 0x73, 0x6d,
-                                  0x6c, 0x20, 0x70, 0x61, 0x72, 0x73, 0x65,
-                                  0x72, 0x74, 0x74, 0x74, 0x74};
-  std::vector<unsigned char> result = {0x74, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73,
-                                       0x20, 0x61, 0x20, 0x73, 0x6d, 0x6c, 0x20,
-                                       0x70, 0x61, 0x72, 0x73, 0x65, 0x72};
-  int length = getExtendedOctetStringLength(&v, position);
-  w.resize(length);
-  EXPECT_EQ(getExtendedOctetStringAsVector(&v, position, &w, length), SML_OK);
-  EXPECT_EQ(w, result);
-}
-
-TEST(getOctetStringAsVector, getChar) {
-    std::vector<unsigned char> w;
-    w.resize(5);
+    size_t position = 1;
+    EXPECT_TRUE(lexer.getOctetString(v.data(), v.size(), position, 10).empty());
+}
+
+TEST(getExtendedOctetString, extendedOctetString) {
+    SmlLexer lexer;
+    std::vector<unsigned char> v = {0x81, 0x04, 0x74, 0x68, 0x69, 0x73, 0x20,
+                                    0x69, 0x73, 0x20, 0x61, 0x20, 0x73, 0x6d,
+                                    0x6c, 0x20, 0x70, 0x61, 0x72, 0x73, 0x65,
+                                    0x72, 0x74, 0x74, 0x74, 0x74};
+    size_t position = 0;
+    const int length = lexer.getExtendedOctetStringLength(v.data(), v.size(), position);
+    EXPECT_EQ(length, 18);
+    EXPECT_EQ(lexer.getExtendedOctetString(v.data(), v.size(), position, length),
+              std::string("this is a sml pars"));
+}
+
+TEST(getOctetString, getChar) {
+    SmlLexer lexer;
     std::vector<unsigned char> v = {0x06, 0x68, 0x61, 0x6c, 0x6c, 0x6f};
-    std::vector<unsigned char> result = {0x68, 0x61, 0x6c, 0x6c, 0x6f};
-    EXPECT_EQ(getOctetStringAsVector(&v, 1, &w, getOctetStringLength(v.at(0))), SML_OK);
-    EXPECT_EQ(result, w);
+    size_t position = 1;
+    const SmlBytesView view = lexer.getOctetString(
+        v.data(), v.size(), position, lexer.getOctetStringLength(v.at(0)));
+    EXPECT_EQ(view, std::string("hallo"));
+    EXPECT_EQ(view.data, &v[1]);
 }
 
 TEST(isUnsigned8, isUnsigned8) {
-    unsigned char testChar1 = 0x00;
-    unsigned char testChar2 = 0x62;
-    unsigned char testChar3 = 0xFF;
-    EXPECT_EQ(isUnsigned8(testChar1), false);
-    EXPECT_EQ(isUnsigned8(testChar2), true);
-    EXPECT_EQ(isUnsigned8(testChar3), false);
+    SmlLexer lexer;
+    EXPECT_EQ(lexer.isUnsigned8(0x00), false);
+    EXPECT_EQ(lexer.isUnsigned8(0x62), true);
+    EXPECT_EQ(lexer.isUnsigned8(0xFF), false);
 }
 
 TEST(getUnsigned8, getUnsigned8) {
+    SmlLexer lexer;
     std::vector<unsigned char> v = {0x62, 0};
-    int position = 0;
-    EXPECT_EQ(getUnsigned8(&v, position), 0);
+    size_t position = 0;
+    EXPECT_EQ(lexer.getUnsigned8(v.data(), v.size(), position), 0);
+    EXPECT_EQ(position, 2);
 
     std::vector<unsigned char> ww = {0x62};
     position = 1;
-    EXPECT_EQ(getUnsigned8(&ww, position), 0xFF);
+    EXPECT_EQ(lexer.getUnsigned8(ww.data(), ww.size(), position), 0xFF);
 
     position = 0;
-    EXPECT_EQ(getUnsigned8(&ww, position), 0xFF);
+    EXPECT_EQ(lexer.getUnsigned8(ww.data(), ww.size(), position), 0xFF);
+    EXPECT_EQ(position, 0);
 
     std::vector<unsigned char> vv = {0x62, 0x99};
-    EXPECT_EQ(getUnsigned8(&vv, position), 0x99);
+    EXPECT_EQ(lexer.getUnsigned8(vv.data(), vv.size(), position), 0x99);
 
     std::vector<unsigned char> vvv = {0x63, 10};
-    EXPECT_EQ(getUnsigned8(&vvv, position), 0xFF);
+    position = 0;
+    EXPECT_EQ(lexer.getUnsigned8(vvv.data(), vvv.size(), position), 0xFF);
 }
 
 TEST(getUnsigned16, getUnsigned16) {
+    SmlLexer lexer;
     std::vector<unsigned char> v = {0x62, 0};
-    int position = 0;
-    EXPECT_EQ(getUnsigned16(&v, position), 0xFFFF);
+    size_t position = 0;
+    EXPECT_EQ(lexer.getUnsigned16(v.data(), v.size(), position), 0xFFFF);
 
     v = {0x63};
-    EXPECT_EQ(getUnsigned16(&v, position), 0xFFFF);
+    EXPECT_EQ(lexer.getUnsigned16(v.data(), v.size(), position), 0xFFFF);
 
     v = {0x63, 0x10};
-    EXPECT_EQ(getUnsigned16(&v, position), 0xFFFF);
+    EXPECT_EQ(lexer.getUnsigned16(v.data(), v.size(), position), 0xFFFF);
 
     v = {0x63, 0x11, 0x11};
-    EXPECT_EQ(getUnsigned16(&v, position), 0x1111);
+    EXPECT_EQ(lexer.getUnsigned16(v.data(), v.size(), position), 0x1111);
 }
 
 TEST(getUnsigned32, getUnsigned32) {
+    SmlLexer lexer;
     std::vector<unsigned char> v = {0x62, 0};
-    int position = 0;
-    EXPECT_EQ(getUnsigned32(&v, position), 0xFFFFFFFF);
+    size_t position = 0;
+    EXPECT_EQ(lexer.getUnsigned32(v.data(), v.size(), position), 0xFFFFFFFF);
 
     v = {0x65};
-    EXPECT_EQ(getUnsigned32(&v, position), 0xFFFFFFFF);
+    EXPECT_EQ(lexer.getUnsigned32(v.data(), v.size(), position), 0xFFFFFFFF);
 
     v = {0x65, 0x10};
-    EXPECT_EQ(getUnsigned32(&v, position), 0xFFFFFFFF);
+    EXPECT_EQ(lexer.getUnsigned32(v.data(), v.size(), position), 0xFFFFFFFF);
 
     v = {0x65, 0x11, 0x11};
-    EXPECT_EQ(getUnsigned32(&v, position), 0xFFFFFFFF);
+    EXPECT_EQ(lexer.getUnsigned32(v.data(), v.size(), position), 0xFFFFFFFF);
 
     v = {0x65, 0x11, 0x11, 0x11};
-    EXPECT_EQ(getUnsigned32(&v, position), 0xFFFFFFFF);
+    EXPECT_EQ(lexer.getUnsigned32(v.data(), v.size(), position), 0xFFFFFFFF);
 
     v = {0x65, 0x11, 0x11, 0x11, 0x11};
-    EXPECT_EQ(getUnsigned32(&v, position), 0x11111111);
+    EXPECT_EQ(lexer.getUnsigned32(v.data(), v.size(), position), 0x11111111);
 }
 
 TEST(getUnsigned64, getUnsigned64) {
+    SmlLexer lexer;
     std::vector<unsigned char> v = {0x62, 0};
-    int position = 0;
-    EXPECT_EQ(getUnsigned64(&v, position), 0xFFFFFFFFFFFFFFFF);
-
-    v = {0x69};
-    EXPECT_EQ(getUnsigned64(&v, position), 0xFFFFFFFFFFFFFFFF);
-
-    v = {0x69, 0x10};
-    EXPECT_EQ(getUnsigned64(&v, position), 0xFFFFFFFFFFFFFFFF);
-
-    v = {0x69, 0x11, 0x11};
-    EXPECT_EQ(getUnsigned64(&v, position), 0xFFFFFFFFFFFFFFFF);
-
-    v = {0x69, 0x11, 0x11, 0x11};
-    EXPECT_EQ(getUnsigned64(&v, position), 0xFFFFFFFFFFFFFFFF);
-
-    v = {0x69, 0x11, 0x11, 0x11, 0x11};
-    EXPECT_EQ(getUnsigned64(&v, position), 0xFFFFFFFFFFFFFFFF);
-
-    v = {0x69, 0x11, 0x11, 0x11, 0x11, 0x11};
-    EXPECT_EQ(getUnsigned64(&v, position), 0xFFFFFFFFFFFFFFFF);
+    size_t position = 0;
+    EXPECT_EQ(lexer.getUnsigned64(v.data(), v.size(), position), 0xFFFFFFFFFFFFFFFF);
 
-    v = {0x69, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11};
-    EXPECT_EQ(getUnsigned64(&v, position), 0xFFFFFFFFFFFFFFFF);
+    // every truncation of the 8 payload bytes fails
+    std::vector<unsigned char> full = {0x69, 0x11, 0x11, 0x11, 0x11,
+                                       0x11, 0x11, 0x11, 0x11};
+    for (size_t size = 1; size < full.size(); ++size) {
+        EXPECT_EQ(lexer.getUnsigned64(full.data(), size, position), 0xFFFFFFFFFFFFFFFF);
+        EXPECT_EQ(position, 0);
+    }
 
-    v = {0x69, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11};
-    EXPECT_EQ(getUnsigned64(&v, position), 0xFFFFFFFFFFFFFFFF);
-
-    v = {0x69, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11};
-    EXPECT_EQ(getUnsigned64(&v, position), 0x1111111111111111);
+    EXPECT_EQ(lexer.getUnsigned64(full.data(), full.size(), position), 0x1111111111111111);
+    EXPECT_EQ(position, 9);
 }
 
 TEST(list, getSmlListLength) {
+    SmlLexer lexer;
     std::vector<unsigned char> v = {0x86};
-    EXPECT_NE(getSmlListLength(&v, 0), 6);
-    EXPECT_EQ(getSmlListLength(&v, 0), 0xFF);
+    EXPECT_NE(lexer.getSmlListLength(v.data(), 0), 6);
+    EXPECT_EQ(lexer.getSmlListLength(v.data(), 0), 0xFF);
 
     v = {0x76};
-    EXPECT_EQ(getSmlListLength(&v, 0), 6);
+    EXPECT_EQ(lexer.getSmlListLength(v.data(), 0), 6);
 }
 
 TEST(smltime, getSmlTime) {
+    SmlLexer lexer;
     std::vector<unsigned char> v = {0x73, 0x62, 0x01, 0x01, 0x01, 0x01, 0x01};
-    int position = 0;
-    EXPECT_EQ(getSmlTime(&v, position).timeValue, 0xFFFFFFFF);
+    size_t position = 0;
+    EXPECT_EQ(lexer.getSmlTime(v.data(), v.size(), position).timeValue, 0xFFFFFFFF);
     EXPECT_EQ(position, 0x00);
 
     position = 0;
     std::vector<unsigned char> w = {0x72, 0x62, 0x01, 0x01, 0x01, 0x01, 0x01};
-    EXPECT_EQ(getSmlTime(&w, position).timeValue, 0xFFFFFFFF);
+    EXPECT_EQ(lexer.getSmlTime(w.data(), w.size(), position).timeValue, 0xFFFFFFFF);
     EXPECT_EQ(position, 0x03);
 
     position = 0;
     std::vector<unsigned char> x = {0x72, 0x62, 0x01, 0x65, 0x01, 0x01, 0x01, 0x01};
-    EXPECT_EQ(getSmlTime(&x, position).timeValue, 0x01010101);
+    const SmlTime secIndex = lexer.getSmlTime(x.data(), x.size(), position);
+    EXPECT_EQ(secIndex.timeType, SmlTimeType::secIndex);
+    EXPECT_EQ(secIndex.timeValue, 0x01010101);
     EXPECT_EQ(position, 0x08);
 
     position = 0;
     std::vector<unsigned char> y = {0x72, 0x62, 0x02, 0x65, 0x01, 0x01, 0x01, 0x01};
-    EXPECT_EQ(getSmlTime(&y, position).timeValue, 0x01010101);
+    const SmlTime timeStamp = lexer.getSmlTime(y.data(), y.size(), position);
+    EXPECT_EQ(timeStamp.timeType, SmlTimeType::timeStamp);
+    EXPECT_EQ(timeStamp.timeValue, 0x01010101);
     EXPECT_EQ(position, 0x08);
 }
 
 TEST(smlStatus, getSmlStatus) {
+    SmlLexer lexer;
     std::vector<unsigned char> v = {0x61, 0x12, 0x34};
-    int position = 0;
-    EXPECT_EQ(getSmlStatus(&v, position), 0xFFFFFFFFFFFFFFFF);
+    size_t position = 0;
+    EXPECT_EQ(lexer.getSmlStatus(v.data(), v.size(), position), 0xFFFFFFFFFFFFFFFF);
 
     v = {0x62, 0x56};
     position = 0;
-    EXPECT_EQ(getSmlStatus(&v, position), 0x56);
+    EXPECT_EQ(lexer.getSmlStatus(v.data(), v.size(), position), 0x56);
 
     v = {0x63, 0x12, 0x34};
     position = 0;
-    EXPECT_EQ(getSmlStatus(&v, position), 0x1234);
+    EXPECT_EQ(lexer.getSmlStatus(v.data(), v.size(), position), 0x1234);
 
     v = {0x65, 0x12, 0x34, 0x56, 0x78};
     position = 0;
-    EXPECT_EQ(getSmlStatus(&v, position), 0x12345678);
+    EXPECT_EQ(lexer.getSmlStatus(v.data(), v.size(), position), 0x12345678);
 
     v = {0x69, 0x12, 0x34, 0x56, 0x78, 0x12, 0x34, 0x56, 0x78};
     position = 0;
-    EXPECT_EQ(getSmlStatus(&v, position), 0x1234567812345678);
-}
\ No newline at end of file
+    EXPECT_EQ(lexer.getSmlStatus(v.data(), v.size(), position), 0x1234567812345678);
+}
+
+TEST(getUnsigned, allWidths) {
+    SmlLexer lexer;
+    unsigned char u24[] = {0x64, 0x01, 0x02, 0x03};
+    size_t position = 0;
+    EXPECT_EQ(lexer.getUnsigned(u24, sizeof(u24), position), 0x010203u);
+    EXPECT_EQ(position, 4);
+
+    unsigned char u40[] = {0x66, 0x00, 0x07, 0x5b, 0xcd, 0x15};
+    position = 0;
+    EXPECT_EQ(lexer.getUnsigned(u40, sizeof(u40), position), 123456789u);
+
+    unsigned char u56[] = {0x68, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    position = 0;
+    EXPECT_EQ(lexer.getUnsigned(u56, sizeof(u56), position), 0x01020304050607u);
+
+    unsigned char truncated[] = {0x66, 0x00, 0x07};
+    position = 0;
+    EXPECT_EQ(lexer.getUnsigned(truncated, sizeof(truncated), position),
+              0xFFFFFFFFFFFFFFFF);
+    EXPECT_EQ(position, 0);
+}
+
+TEST(getInteger, signExtension) {
+    SmlLexer lexer;
+    unsigned char i24[] = {0x54, 0xff, 0xfe, 0x38};
+    size_t position = 0;
+    EXPECT_EQ(lexer.getInteger(i24, sizeof(i24), position), -456);
+
+    unsigned char i48[] = {0x57, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00};
+    position = 0;
+    EXPECT_EQ(lexer.getInteger(i48, sizeof(i48), position), 256);
+
+    unsigned char i8[] = {0x52, 0xff};
+    position = 0;
+    EXPECT_EQ(lexer.getInteger(i8, sizeof(i8), position), -1);
+}
+
+// Appends one SML message with transactionId, groupNo, abortOnError, the
+// given body, its CRC and EndOfSmlMsg
+static void appendMessage(std::vector<unsigned char> &frame,
+                          const std::vector<unsigned char> &body) {
+    const size_t start = frame.size();
+    frame.insert(frame.end(), {0x76, 0x02, 0x01, 0x62, 0x00, 0x62, 0x00});
+    frame.insert(frame.end(), body.begin(), body.end());
+    SmlCrc16 crc;
+    crc.update(&frame[start], frame.size() - start);
+    const uint16_t value = crc.final();
+    frame.insert(frame.end(), {0x63, static_cast<unsigned char>(value >> 8),
+                               static_cast<unsigned char>(value & 0xff), 0x00});
+}
+
+// Recomputes the transport CRC in the last two bytes of a frame
+static void sealFrame(std::vector<unsigned char> &frame) {
+    SmlCrc16 crc;
+    crc.update(frame.data(), frame.size() - 2);
+    frame[frame.size() - 2] = static_cast<unsigned char>(crc.final() >> 8);
+    frame[frame.size() - 1] = static_cast<unsigned char>(crc.final() & 0xff);
+}
+
+// GetList.Res body of the given list entries with actSensorTime 1000,
+// starting with the message type
+static std::vector<unsigned char>
+getListBody(const std::vector<std::vector<unsigned char>> &entries) {
+    std::vector<unsigned char> body = {0x72, 0x63, 0x07, 0x01, 0x77, 0x01,
+                                       0x03, 0x0a, 0x0b, 0x01, 0x72, 0x62,
+                                       0x01, 0x65, 0x00, 0x00, 0x03, 0xe8};
+    body.push_back(static_cast<unsigned char>(0x70 | entries.size()));
+    for (const std::vector<unsigned char> &entry : entries) {
+        body.insert(body.end(), entry.begin(), entry.end());
+    }
+    body.insert(body.end(), {0x01, 0x01});
+    return body;
+}
+
+// List entry with an Integer64 value, without status, valTime and signature
+static std::vector<unsigned char> listEntry(const ObisCode obis,
+                                            const uint8_t unit,
+                                            const int8_t scaler,
+                                            const int64_t value) {
+    std::vector<unsigned char> entry = {0x77, 0x07};
+    for (int i = 0; i < 6; ++i) {
+        entry.push_back(static_cast<unsigned char>(obis.byte(i)));
+    }
+    entry.insert(entry.end(), {0x01, 0x01, 0x62, unit, 0x52,
+                               static_cast<unsigned char>(scaler), 0x59});
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        entry.push_back(static_cast<unsigned char>(
+            static_cast<uint64_t>(value) >> shift));
+    }
+    entry.push_back(0x01);
+    return entry;
+}
+
+// Replaces the empty valTime of a listEntry() by an SML_Time of the given type
+static std::vector<unsigned char> withValTime(std::vector<unsigned char> entry,
+                                              const uint8_t type,
+                                              const uint32_t time) {
+    std::vector<unsigned char> valTime = {0x72, 0x62, type, 0x65};
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        valTime.push_back(static_cast<unsigned char>(time >> shift));
+    }
+    // 0x77, objName and status come first
+    entry.erase(entry.begin() + 9);
+    entry.insert(entry.begin() + 9, valTime.begin(), valTime.end());
+    return entry;
+}
+
+// Appends PublicClose.Res, padding to a multiple of four bytes and the end
+// sequence with the transport CRC
+static void closeFrame(std::vector<unsigned char> &frame) {
+    appendMessage(frame, {0x72, 0x63, 0x02, 0x01, 0x71, 0x01});
+    const unsigned char padding =
+        static_cast<unsigned char>((4 - frame.size() % 4) % 4);
+    frame.insert(frame.end(), padding, 0x00);
+    frame.insert(frame.end(),
+                 {0x1b, 0x1b, 0x1b, 0x1b, 0x1a, padding, 0x00, 0x00});
+    sealFrame(frame);
+}
+
+// Frame of PublicOpen.Res, a GetList.Res with the given entries and
+// PublicClose.Res, padded to a multiple of four bytes
+static std::vector<unsigned char>
+buildListFrame(const std::vector<std::vector<unsigned char>> &entries) {
+    std::vector<unsigned char> frame = {0x1b, 0x1b, 0x1b, 0x1b,
+                                        0x01, 0x01, 0x01, 0x01};
+    appendMessage(frame, {0x72, 0x63, 0x01, 0x01, 0x76, 0x01, 0x01, 0x03,
+                          0xaa, 0xbb, 0x03, 0x0a, 0x0b, 0x01, 0x01});
+    appendMessage(frame, getListBody(entries));
+    closeFrame(frame);
+    return frame;
+}
+
+// Frame with the total energy as Unsigned32 in Wh with scaler -1
+static std::vector<unsigned char> buildFrame(const uint32_t energy) {
+    return buildListFrame({{0x77, 0x07, 0x01, 0x00, 0x01, 0x08, 0x00, 0xff,
+                            0x01, 0x01, 0x62, 0x1e, 0x52, 0xff, 0x65,
+                            static_cast<unsigned char>(energy >> 24),
+                            static_cast<unsigned char>(energy >> 16),
+                            static_cast<unsigned char>(energy >> 8),
+                            static_cast<unsigned char>(energy), 0x01}});
+}
+
+// Records the total energy of every frame the stream parser completes
+struct StreamRecorder {
+    unsigned char storage[512];
+    SmlStreamParser stream{storage, sizeof(storage)};
+    std::vector<uint64_t> energies;
+
+    StreamRecorder() {
+        stream.setFrameHandler([this](SmlParser &parser) {
+            energies.push_back(
+                parser.getElementByObis(OBIS_TOTAL_ENERGY).iValue());
+        });
+    }
+};
+
+TEST(smlStreamParser, frameSplitAcrossFeeds) {
+    const std::vector<unsigned char> frame = buildFrame(123456);
+    for (size_t chunk = 1; chunk <= frame.size(); chunk += 5) {
+        StreamRecorder recorder;
+        for (size_t i = 0; i < frame.size(); i += chunk) {
+            const size_t size = std::min(chunk, frame.size() - i);
+            EXPECT_EQ(recorder.stream.feed(&frame[i], size), SML_OK);
+        }
+        ASSERT_EQ(recorder.energies.size(), 1u) << "chunk " << chunk;
+        EXPECT_EQ(recorder.energies[0], 123456u);
+        EXPECT_EQ(recorder.stream.getPaddingCount(), frame[frame.size() - 3]);
+    }
+}
+
+TEST(smlStreamParser, truncatedFrameFollowedByGoodFrame) {
+    const std::vector<unsigned char> broken = buildFrame(1);
+    const std::vector<unsigned char> good = buildFrame(2);
+    // the start of the good frame is taken as payload, TL or trailer bytes
+    // of the broken one, depending on where it was cut
+    for (size_t cut = SML_START_SEQUENCE_LENGTH; cut < broken.size() - 1;
+         ++cut) {
+        std::vector<unsigned char> data(broken.begin(), broken.begin() + cut);
+        data.insert(data.end(), good.begin(), good.end());
+
+        StreamRecorder recorder;
+        EXPECT_NE(recorder.stream.feed(data.data(), data.size()), SML_OK);
+        ASSERT_EQ(recorder.energies.size(), 1u) << "cut at " << cut;
+        EXPECT_EQ(recorder.energies[0], 2u);
+
+        StreamRecorder bytewise;
+        for (const unsigned char byte : data) {
+            bytewise.stream.feed(&byte, 1);
+        }
+        EXPECT_EQ(bytewise.energies, recorder.energies) << "cut at " << cut;
+    }
+}
+
+TEST(smlStreamParser, twoFramesInOneChunk) {
+    std::vector<unsigned char> data = buildFrame(1);
+    const size_t first = data.size();
+    const std::vector<unsigned char> second = buildFrame(2);
+    data.insert(data.end(), second.begin(), second.end());
+
+    StreamRecorder recorder;
+    EXPECT_EQ(recorder.stream.feed(data.data(), data.size()), SML_OK);
+    EXPECT_EQ(recorder.energies, (std::vector<uint64_t>{1, 2}));
+
+    // the overload stopping behind a frame keeps its results readable
+    StreamRecorder stopping;
+    SmlParser &parser = stopping.stream.getParser();
+    size_t consumed = 0;
+    EXPECT_EQ(stopping.stream.feed(data.data(), data.size(), consumed), SML_OK);
+    EXPECT_EQ(consumed, first);
+    EXPECT_EQ(parser.getElementByObis(OBIS_TOTAL_ENERGY).iValue(), 1u);
+
+    EXPECT_EQ(stopping.stream.feed(&data[first], data.size() - first, consumed),
+              SML_OK);
+    EXPECT_EQ(consumed, second.size());
+    EXPECT_EQ(parser.getElementByObis(OBIS_TOTAL_ENERGY).iValue(), 2u);
+    EXPECT_EQ(stopping.energies, (std::vector<uint64_t>{1, 2}));
+}
+
+// Reference for sml_find_start_sequence(), one comparison per offset
+static size_t findStartNaive(const std::vector<unsigned char> &data,
+                             const size_t from) {
+    for (size_t i = from; i + SML_START_SEQUENCE_LENGTH <= data.size(); ++i) {
+        if (std::equal(SML_START_SEQUENCE,
+                       SML_START_SEQUENCE + SML_START_SEQUENCE_LENGTH,
+                       &data[i])) {
+            return i;
+        }
+    }
+    return SML_NPOS;
+}
+
+TEST(smlFrameSync, matchesNaiveSearchAtEveryOffset) {
+    // noise of escape runs, ones and near misses, sizes beyond two vector
+    // blocks so every block edge and tail length is crossed
+    uint32_t seed = 12345;
+    for (size_t size = 0; size <= 72; ++size) {
+        std::vector<unsigned char> noise(size);
+        for (unsigned char &byte : noise) {
+            seed = seed * 1103515245 + 12345;
+            const unsigned char choice[] = {0x1b, 0x1b, 0x01, 0x00};
+            byte = choice[(seed >> 16) % 4];
+        }
+        for (size_t from = 0; from <= size; ++from) {
+            EXPECT_EQ(sml_find_start_sequence(noise.data(), size, from),
+                      findStartNaive(noise, from));
+        }
+
+        for (size_t at = 0; at + SML_START_SEQUENCE_LENGTH <= size; ++at) {
+            std::vector<unsigned char> data = noise;
+            std::copy(SML_START_SEQUENCE,
+                      SML_START_SEQUENCE + SML_START_SEQUENCE_LENGTH,
+                      data.begin() + static_cast<std::ptrdiff_t>(at));
+            for (const size_t from : {size_t{0}, at, at + 1}) {
+                EXPECT_EQ(sml_find_start_sequence(data.data(), size, from),
+                          findStartNaive(data, from))
+                    << "size " << size << " at " << at << " from " << from;
+            }
+        }
+    }
+
+    // an escape sequence of five 0x1b, and a sequence cut off by the end
+    const unsigned char five[] = {0x1b, 0x1b, 0x1b, 0x1b, 0x1b,
+                                  0x01, 0x01, 0x01, 0x01};
+    EXPECT_EQ(sml_find_start_sequence(five, sizeof(five), 0), 1u);
+    EXPECT_EQ(sml_find_start_sequence(five, sizeof(five) - 1, 0), SML_NPOS);
+    EXPECT_EQ(sml_find_start_sequence(nullptr, 8, 0), SML_NPOS);
+}
+
+TEST(smlCrc16, incrementalMatchesReference) {
+    unsigned char data[100];
+    for (int i = 0; i < 100; ++i) {
+        data[i] = static_cast<unsigned char>(i * 37 + 11);
+    }
+
+    for (int len = 0; len <= 100; ++len) {
+        for (int split = 0; split <= len; split += 7) {
+            SmlCrc16 crc;
+            crc.update(data, split);
+            crc.update(&data[split], len - split);
+            EXPECT_EQ(crc.final(), sml_crc16(data, len));
+        }
+    }
+}
+
+TEST(smlTransport, crcAndPaddingVerified) {
+    const std::vector<unsigned char> frame = buildFrame(42);
+    const unsigned char padding = frame[frame.size() - 3];
+    ASSERT_GT(padding, 0u);
+
+    SmlParser parser(const_cast<unsigned char *>(frame.data()), frame.size());
+    EXPECT_EQ(parser.parseSml(), SML_OK);
+    EXPECT_EQ(parser.getPaddingCount(), padding);
+
+    // every single bit error is caught, by a message CRC or the transport
+    // CRC over the padding, the end sequence and the padding count
+    for (size_t i = 0; i < frame.size(); ++i) {
+        for (int bit = 0; bit < 8; ++bit) {
+            std::vector<unsigned char> broken = frame;
+            broken[i] ^= static_cast<unsigned char>(1 << bit);
+            SmlParser brokenParser(broken.data(), broken.size());
+            EXPECT_NE(brokenParser.parseSml(), SML_OK)
+                << "byte " << i << " bit " << bit;
+
+            StreamRecorder recorder;
+            recorder.stream.feed(broken.data(), broken.size());
+            EXPECT_TRUE(recorder.energies.empty())
+                << "byte " << i << " bit " << bit;
+        }
+    }
+
+    // a padding byte missing is caught even with a matching count
+    std::vector<unsigned char> shortened = frame;
+    shortened.erase(shortened.end() - 9);
+    shortened[shortened.size() - 3] = static_cast<unsigned char>(padding - 1);
+    SmlParser shortenedParser(shortened.data(), shortened.size());
+    EXPECT_EQ(shortenedParser.parseSml(), SML_ERROR_CRC);
+
+    std::vector<unsigned char> resealed = shortened;
+    sealFrame(resealed);
+    SmlParser resealedParser(resealed.data(), resealed.size());
+    EXPECT_EQ(resealedParser.parseSml(), SML_OK);
+    EXPECT_EQ(resealedParser.getPaddingCount(), padding - 1);
+}
+
+TEST(smlObisIndex, findsFirstOccurrence) {
+    SmlObisIndex index;
+    for (uint16_t i = 0; i < 40; ++i) {
+        const unsigned char obis[] = {0x01, 0x00, static_cast<unsigned char>(i),
+                                      0x08, 0x00, 0xff};
+        EXPECT_TRUE(index.insert(ObisCode::fromBytes(obis, sizeof(obis)), i));
+    }
+    index.insert(OBIS_TOTAL_ENERGY, 99);
+
+    EXPECT_EQ(index.find(OBIS_TOTAL_ENERGY), 1);
+    EXPECT_EQ(index.find(OBIS_MANUFACTURER), -1);
+    EXPECT_FALSE(index.isIncomplete());
+
+    index.clear();
+    EXPECT_EQ(index.find(OBIS_TOTAL_ENERGY), -1);
+}
+
+TEST(obisCode, literalsAndText) {
+    const unsigned char raw[] = {0x01, 0x00, 0x10, 0x07, 0x00, 0xff};
+    EXPECT_EQ(ObisCode::fromBytes(raw, sizeof(raw)), OBIS_SUM_ACT_INST_PWR);
+    EXPECT_EQ(OBIS_SUM_ACT_INST_PWR.toString(), "1-0:16.7.0*255");
+    EXPECT_EQ(OBIS_MANUFACTURER.toString(), "129-129:199.130.3*255");
+
+    EXPECT_FALSE(ObisCode::parse("1-0:1.8", 7).isValid());
+    EXPECT_FALSE(ObisCode::parse("1-0:1.8.256*255", 15).isValid());
+    EXPECT_FALSE(ObisCode::fromBytes(raw, 5).isValid());
+    EXPECT_EQ(ObisCode().toString(), "");
+}
+
+TEST(skipElement, nestedListsAndExtendedLength) {
+    SmlLexer lexer;
+    // list of 3: unsigned8, list of 2 (octet string, empty optional),
+    // octet string with extended TL of 17 bytes
+    unsigned char data[40] = {0x73, 0x62, 0x05, 0x72, 0x02, 0xaa, 0x01,
+                              0x81, 0x01};
+    size_t position = 0;
+    EXPECT_TRUE(lexer.skipElement(data, 24, position));
+    EXPECT_EQ(position, 24);
+
+    position = 0;
+    EXPECT_FALSE(lexer.skipElement(data, 23, position));
+    EXPECT_EQ(position, 0);
+}
+
+TEST(getExtendedOctetString, payloadWithHighBytes) {
+    SmlLexer lexer;
+    // 48 byte public key behind the TL bytes 0x83 0x02, its bytes look like
+    // TL bytes with the more flag set
+    unsigned char data[51] = {0x83, 0x02};
+    for (size_t i = 2; i < 50; ++i) {
+        data[i] = static_cast<unsigned char>(0x9a + i);
+    }
+    data[50] = 0x01;
+
+    size_t position = 0;
+    const int length =
+        lexer.getExtendedOctetStringLength(data, sizeof(data), position);
+    ASSERT_EQ(length, 48);
+    EXPECT_EQ(position, 2);
+    SmlBytesView key =
+        lexer.getExtendedOctetString(data, sizeof(data), position, length);
+    EXPECT_EQ(position, 2);
+    EXPECT_EQ(key.data, &data[2]);
+    EXPECT_EQ(key.length, 48u);
+
+    // list entry: objName, status, valTime, unit, scaler, value, signature
+    std::vector<unsigned char> entry = {0x77, 0x07, 0x81, 0x81, 0xc7, 0x82,
+                                        0x05, 0xff, 0x01, 0x01, 0x01, 0x01};
+    entry.insert(entry.end(), data, data + sizeof(data));
+    SmlParser parser(entry.data(), entry.size());
+    position = 0;
+    SmlListEntry parsed =
+        parser.parseSmlListEntry(entry.data(), entry.size(), position);
+    EXPECT_EQ(parsed.obis(), OBIS_PUB_KEY);
+    ASSERT_EQ(parsed.sValue().size(), 48u);
+    EXPECT_EQ(parsed.sValue().data[0], 0x9c);
+    EXPECT_EQ(position, entry.size());
+}
+
+TEST(smlObisSet, sortedAtCompileTime) {
+    static constexpr SmlObisSet wanted{OBIS_SUM_ACT_INST_PWR_L3,
+                                       OBIS_TOTAL_ENERGY, OBIS_MANUFACTURER};
+    static_assert(wanted.contains(OBIS_TOTAL_ENERGY));
+    static_assert(!wanted.contains(OBIS_ENERGY_T1));
+
+    const SmlObisFilter filter = wanted;
+    EXPECT_TRUE(filter.isActive());
+    EXPECT_TRUE(filter.contains(OBIS_MANUFACTURER));
+    EXPECT_TRUE(filter.contains(OBIS_SUM_ACT_INST_PWR_L3));
+    EXPECT_FALSE(filter.contains(OBIS_PUB_KEY));
+    EXPECT_FALSE(SmlObisFilter().isActive());
+}
+
+TEST(smlParser, obisFilterSkipsUnwantedEntries) {
+    std::vector<unsigned char> frame = buildListFrame({
+        listEntry(OBIS_MANUFACTURER, 0xff, 0, 7),
+        listEntry(OBIS_TOTAL_ENERGY, 0x1e, -1, 123456),
+        listEntry(OBIS_ENERGY_T1, 0x1e, -1, 1111),
+        listEntry(OBIS_SUM_ACT_INST_PWR, 0x1b, 0, -250),
+        listEntry(OBIS_ENERGY_T2, 0x1e, -1, 2222),
+    });
+    static constexpr SmlObisSet wanted{OBIS_SUM_ACT_INST_PWR,
+                                       OBIS_TOTAL_ENERGY};
+
+    SmlParser parser(frame.data(), frame.size());
+    // a first frame without filter, its entries must not survive
+    ASSERT_EQ(parser.parseSml(), SML_OK);
+    EXPECT_EQ(parser.getElementByObis(OBIS_ENERGY_T1).iValue(), 1111u);
+
+    parser.setObisFilter(wanted);
+    ASSERT_EQ(parser.parseSml(), SML_OK);
+    const SmlListEntry &energy = parser.getElementByObis(OBIS_TOTAL_ENERGY);
+    EXPECT_EQ(energy.iValue(), 123456u);
+    EXPECT_EQ(energy.unit(), 0x1e);
+    EXPECT_EQ(energy.scaler(), -1);
+    const SmlListEntry &power = parser.getElementByObis(OBIS_SUM_ACT_INST_PWR);
+    EXPECT_TRUE(power.isSigned());
+    EXPECT_EQ(static_cast<int64_t>(power.iValue()), -250);
+    EXPECT_EQ(parser.getSensorTime().timeValue, 1000u);
+
+    for (const ObisCode skipped :
+         {OBIS_MANUFACTURER, OBIS_ENERGY_T1, OBIS_ENERGY_T2}) {
+        EXPECT_TRUE(parser.getElementByObis(skipped).objName().empty());
+    }
+    const ObisCode codes[] = {OBIS_ENERGY_T1, OBIS_TOTAL_ENERGY};
+    const SmlListEntry *results[2];
+    EXPECT_EQ(parser.getElementsByObis(codes, results), 1u);
+    EXPECT_EQ(results[0], nullptr);
+    EXPECT_EQ(results[1], &energy);
+
+    // the skipped entries are still covered by the message CRC
+    frame[frame.size() / 2] ^= 0x01;
+    EXPECT_EQ(parser.parseSml(), SML_ERROR_CRC);
+}
+
+// Upstream of an arena that counts what it has to hand out
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations{0};
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const
+        noexcept override {
+        return this == &other;
+    }
+};
+
+TEST(smlArena, framesWithoutUpstreamAllocation) {
+    std::vector<std::vector<unsigned char>> entries;
+    for (int i = 0; i < 12; ++i) {
+        entries.push_back(listEntry(OBIS_TOTAL_ENERGY, 0x1e, -1, i));
+    }
+    entries[3] = listEntry(OBIS_SUM_ACT_INST_PWR, 0x1b, 0, -42);
+    std::vector<unsigned char> frame = buildListFrame(entries);
+
+    alignas(std::max_align_t) static unsigned char storage[2048];
+    CountingResource upstream;
+    SmlArena arena(storage, sizeof(storage), &upstream);
+    SmlParser parser(frame.data(), frame.size(), &arena);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(parser.parseSml(), SML_OK);
+        EXPECT_EQ(static_cast<int64_t>(
+                      parser.getElementByObis(OBIS_SUM_ACT_INST_PWR).iValue()),
+                  -42);
+    }
+    EXPECT_EQ(upstream.allocations, 0u);
+
+    // an arena that does not even fall back to the heap
+    SmlArena strict(storage, sizeof(storage), std::pmr::null_memory_resource());
+    SmlParser strictParser(frame.data(), frame.size(), &strict);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(strictParser.parseSml(), SML_OK);
+    }
+
+    // the counter sees a frame that does not fit
+    alignas(std::max_align_t) static unsigned char small[64];
+    SmlArena tooSmall(small, sizeof(small), &upstream);
+    SmlParser spilling(frame.data(), frame.size(), &tooSmall);
+    ASSERT_EQ(spilling.parseSml(), SML_OK);
+    EXPECT_GT(upstream.allocations, 0u);
+    EXPECT_EQ(spilling.getElementByObis(OBIS_TOTAL_ENERGY).iValue(), 0u);
+}
+
+TEST(smlParser, listStorageReusedAcrossFrames) {
+    const std::vector<std::vector<unsigned char>> longList = {
+        listEntry(OBIS_MANUFACTURER, 0xff, 0, 1),
+        listEntry(OBIS_TOTAL_ENERGY, 0x1e, -1, 1000),
+        listEntry(OBIS_ENERGY_T1, 0x1e, -1, 600),
+        listEntry(OBIS_ENERGY_T2, 0x1e, -1, 400),
+        listEntry(OBIS_SUM_ACT_INST_PWR, 0x1b, 0, 300),
+        listEntry(OBIS_SUM_ACT_INST_PWR_L1, 0x1b, 0, 100),
+    };
+    const std::vector<std::vector<unsigned char>> shortList = {
+        listEntry(OBIS_TOTAL_ENERGY, 0x1e, -1, 1001),
+        listEntry(OBIS_SUM_ACT_INST_PWR, 0x1b, 0, 310),
+    };
+
+    // the body behind the message type, parsed into the same storage
+    SmlParser parser(nullptr, 0);
+    SmlGetListRes res;
+    std::vector<unsigned char> body = getListBody(longList);
+    size_t position = 4;
+    parser.parseSmlGetListRes(body.data(), body.size(), position, res);
+    EXPECT_EQ(position, body.size());
+    ASSERT_EQ(res.valList.size(), longList.size());
+    const size_t capacity = res.valList.capacity();
+    const SmlListEntry *storage = res.valList.data();
+
+    body = getListBody(shortList);
+    position = 4;
+    parser.parseSmlGetListRes(body.data(), body.size(), position, res);
+    ASSERT_EQ(res.valList.size(), shortList.size());
+    EXPECT_EQ(res.valList.capacity(), capacity);
+    EXPECT_EQ(res.valList.data(), storage);
+    EXPECT_EQ(res.valList[0].iValue(), 1001u);
+    EXPECT_EQ(res.valList[1].iValue(), 310u);
+
+    // whole frames through one parser, the longer one first
+    std::vector<unsigned char> longFrame = buildListFrame(longList);
+    std::vector<unsigned char> shortFrame = buildListFrame(shortList);
+    parser.setBuffer(longFrame.data(), longFrame.size());
+    ASSERT_EQ(parser.parseSml(), SML_OK);
+    EXPECT_EQ(parser.getElementByObis(OBIS_ENERGY_T2).iValue(), 400u);
+
+    parser.setBuffer(shortFrame.data(), shortFrame.size());
+    ASSERT_EQ(parser.parseSml(), SML_OK);
+    EXPECT_EQ(parser.getElementByObis(OBIS_TOTAL_ENERGY).iValue(), 1001u);
+    EXPECT_EQ(parser.getElementByObis(OBIS_SUM_ACT_INST_PWR).iValue(), 310u);
+    for (const ObisCode stale : {OBIS_MANUFACTURER, OBIS_ENERGY_T1,
+                                 OBIS_ENERGY_T2, OBIS_SUM_ACT_INST_PWR_L1}) {
+        EXPECT_TRUE(parser.getElementByObis(stale).objName().empty());
+    }
+
+    parser.setBuffer(longFrame.data(), longFrame.size());
+    ASSERT_EQ(parser.parseSml(), SML_OK);
+    EXPECT_EQ(parser.getElementByObis(OBIS_SUM_ACT_INST_PWR_L1).iValue(), 100u);
+}
+
+// Records the callbacks of parseSml(Visitor &) in their order
+struct RecordingVisitor : SmlVisitor {
+    std::vector<std::string> calls;
+    std::vector<sml_error_t> errors;
+
+    void onOpenRes(const SmlPublicOpenRes &) { calls.push_back("open"); }
+    void onListStart(const SmlGetListRes &res) {
+        calls.push_back("list " + std::to_string(res.actSensorTime.timeValue));
+    }
+    void onListEntry(const SmlListEntryView &entry) {
+        calls.push_back(entry.obis().toString() + "=" +
+                        std::to_string(static_cast<int64_t>(entry.iValue())));
+    }
+    void onCloseRes(const SmlPublicCloseRes &) { calls.push_back("close"); }
+    void onError(const sml_error_t error) { errors.push_back(error); }
+};
+
+TEST(smlParser, visitorCallbackOrder) {
+    std::vector<unsigned char> frame = buildListFrame({
+        listEntry(OBIS_TOTAL_ENERGY, 0x1e, -1, 5000),
+        listEntry(OBIS_ENERGY_T1, 0x1e, -1, 3000),
+        listEntry(OBIS_SUM_ACT_INST_PWR, 0x1b, 0, -7),
+    });
+
+    SmlParser parser(frame.data(), frame.size());
+    RecordingVisitor visitor;
+    ASSERT_EQ(parser.parseSml(visitor), SML_OK);
+    EXPECT_EQ(visitor.calls,
+              (std::vector<std::string>{"open", "list 1000",
+                                        "1-0:1.8.0*255=5000",
+                                        "1-0:1.8.1*255=3000",
+                                        "1-0:16.7.0*255=-7", "close"}));
+    EXPECT_TRUE(visitor.errors.empty());
+    // nothing is stored for getElementByObis()
+    EXPECT_TRUE(parser.getElementByObis(OBIS_TOTAL_ENERGY).objName().empty());
+
+    // the filter applies to onListEntry()
+    static constexpr SmlObisSet wanted{OBIS_ENERGY_T1};
+    parser.setObisFilter(wanted);
+    RecordingVisitor filtered;
+    ASSERT_EQ(parser.parseSml(filtered), SML_OK);
+    EXPECT_EQ(filtered.calls,
+              (std::vector<std::string>{"open", "list 1000",
+                                        "1-0:1.8.1*255=3000", "close"}));
+    parser.setObisFilter(SmlObisFilter());
+
+    // a broken transport CRC is reported after all messages were visited
+    frame.back() ^= 0x01;
+    RecordingVisitor badCrc;
+    EXPECT_EQ(parser.parseSml(badCrc), SML_ERROR_CRC);
+    EXPECT_EQ(badCrc.calls.back(), "close");
+    EXPECT_EQ(badCrc.errors, (std::vector<sml_error_t>{SML_ERROR_CRC}));
+    frame.back() ^= 0x01;
+
+    // every cut reports one error, the one parseSml() returns; a cut
+    // behind the GetList.Res (before the 17 byte PublicClose.Res, padding
+    // and end sequence) is a truncated frame
+    const size_t closeStart = frame.size() - 17 - frame[frame.size() - 3] - 8;
+    for (size_t size = SML_START_SEQUENCE_LENGTH; size < frame.size(); ++size) {
+        SmlParser truncated(frame.data(), size);
+        RecordingVisitor cut;
+        const sml_error_t result = truncated.parseSml(cut);
+        EXPECT_NE(result, SML_OK) << size;
+        EXPECT_EQ(result, truncated.parseSml()) << size;
+        EXPECT_EQ(cut.errors, (std::vector<sml_error_t>{result})) << size;
+        if (size == closeStart) {
+            EXPECT_EQ(result, SML_ERROR_SIZE);
+            EXPECT_EQ(cut.calls.back(), "1-0:16.7.0*255=-7");
+        }
+        // messages are visited before their CRC is checked
+        if (size <= closeStart) {
+            EXPECT_EQ(std::count(cut.calls.begin(), cut.calls.end(), "close"),
+                      0);
+        }
+    }
+}
+
+TEST(smlParser, skipsMessagesOfUnknownType) {
+    std::vector<unsigned char> frame = {0x1b, 0x1b, 0x1b, 0x1b,
+                                        0x01, 0x01, 0x01, 0x01};
+    appendMessage(frame, {0x72, 0x63, 0x01, 0x01, 0x76, 0x01, 0x01, 0x03,
+                          0xaa, 0xbb, 0x03, 0x0a, 0x0b, 0x01, 0x01});
+    // GetProfileList.Res (0x0501) is not decoded: nested lists, a time, an
+    // Integer and an octet string with extended TL field
+    std::vector<unsigned char> unknown = {
+        0x72, 0x63, 0x05, 0x01, 0x73, 0x03, 0xaa, 0xbb, 0x72, 0x62,
+        0x01, 0x65, 0x00, 0x00, 0x00, 0x01, 0x72, 0x73, 0x01, 0x52,
+        0x05, 0x71, 0x01, 0x81, 0x02};
+    unknown.insert(unknown.end(), 16, 0x1b);
+    appendMessage(frame, unknown);
+    // a message type nobody knows, with a plain Unsigned as body
+    appendMessage(frame, {0x72, 0x63, 0xff, 0x01, 0x62, 0x2a});
+    const std::vector<unsigned char> body =
+        getListBody({listEntry(OBIS_TOTAL_ENERGY, 0x1e, -1, 98765),
+                     listEntry(OBIS_SUM_ACT_INST_PWR, 0x1b, 0, 321)});
+    appendMessage(frame, body);
+    closeFrame(frame);
+
+    SmlParser parser(frame.data(), frame.size());
+    ASSERT_EQ(parser.parseSml(), SML_OK);
+    EXPECT_EQ(parser.getElementByObis(OBIS_TOTAL_ENERGY).iValue(), 98765u);
+    EXPECT_EQ(parser.getElementByObis(OBIS_SUM_ACT_INST_PWR).iValue(), 321u);
+    EXPECT_EQ(parser.getSensorTime().timeValue, 1000u);
+
+    RecordingVisitor visitor;
+    ASSERT_EQ(parser.parseSml(visitor), SML_OK);
+    EXPECT_EQ(visitor.calls,
+              (std::vector<std::string>{"open", "list 1000",
+                                        "1-0:1.8.0*255=98765",
+                                        "1-0:16.7.0*255=321", "close"}));
+
+    // the message CRC still covers the skipped body
+    const size_t skipped = std::search(frame.begin(), frame.end(),
+                                       unknown.begin(), unknown.end()) -
+                           frame.begin();
+    frame[skipped + 30] ^= 0x01;
+    EXPECT_EQ(parser.parseSml(), SML_ERROR_CRC);
+    frame[skipped + 30] ^= 0x01;
+
+    // a body whose TL fields run past its message is a syntax error
+    frame[skipped + 4] = 0x7f;
+    EXPECT_EQ(parser.parseSml(), SML_ERROR_SYNTAX);
+}
+
+TEST(smlParser, listEntryValTime) {
+    std::vector<unsigned char> localTime =
+        listEntry(OBIS_ENERGY_T1, 0x1e, -1, 600);
+    // localTimestamp carries a list of three the lexer does not decode
+    localTime.erase(localTime.begin() + 9);
+    localTime.insert(localTime.begin() + 9,
+                     {0x72, 0x62, 0x03, 0x73, 0x65, 0x5f, 0x5e, 0x10, 0x00,
+                      0x53, 0x00, 0x3c, 0x53, 0x00, 0x00});
+    const std::vector<std::vector<unsigned char>> entries = {
+        withValTime(listEntry(OBIS_TOTAL_ENERGY, 0x1e, -1, 1000), 2,
+                    0x5f5e1000),
+        localTime,
+        withValTime(listEntry(OBIS_ENERGY_T2, 0x1e, -1, 400), 1, 990),
+        listEntry(OBIS_SUM_ACT_INST_PWR, 0x1b, 0, -250),
+    };
+
+    SmlParser parser(nullptr, 0);
+    SmlGetListRes res;
+    const std::vector<unsigned char> body = getListBody(entries);
+    size_t position = 4;
+    parser.parseSmlGetListRes(body.data(), body.size(), position, res);
+    EXPECT_EQ(position, body.size());
+    ASSERT_EQ(res.valList.size(), entries.size());
+
+    const SmlListEntry &energy = res.valList[0];
+    EXPECT_EQ(energy.valTime().timeType, SmlTimeType::timeStamp);
+    EXPECT_EQ(energy.valTime().timeValue, 0x5f5e1000u);
+    EXPECT_EQ(energy.unit(), 0x1e);
+    EXPECT_EQ(energy.scaler(), -1);
+    EXPECT_EQ(energy.iValue(), 1000u);
+
+    // skipped as a whole, the fields behind it still line up
+    EXPECT_EQ(res.valList[1].valTime().timeValue, 0u);
+    EXPECT_EQ(res.valList[1].iValue(), 600u);
+    EXPECT_EQ(res.valList[2].valTime().timeType, SmlTimeType::secIndex);
+    EXPECT_EQ(res.valList[2].valTime().timeValue, 990u);
+    EXPECT_EQ(res.valList[2].iValue(), 400u);
+    EXPECT_EQ(res.valList[3].valTime().timeValue, 0u);
+    EXPECT_EQ(res.valList[3].unit(), 0x1b);
+    EXPECT_EQ(static_cast<int64_t>(res.valList[3].iValue()), -250);
+}
+
+TEST(smlListEntry, taggedValue) {
+    SmlListEntry entry;
+    EXPECT_TRUE(entry.objName().empty());
+    EXPECT_FALSE(entry.obis().isValid());
+    EXPECT_EQ(entry.value(), 0.0);
+
+    const unsigned char name[] = {0x01, 0x00, 0x10, 0x07, 0x00, 0xff};
+    EXPECT_TRUE(entry.setObjName(SmlBytesView{name, sizeof(name)}));
+    EXPECT_EQ(entry.obis(), OBIS_SUM_ACT_INST_PWR);
+
+    entry.setScaler(-1);
+    entry.setInteger(-4567);
+    EXPECT_TRUE(entry.isSigned());
+    EXPECT_DOUBLE_EQ(entry.value(), -456.7);
+
+    const unsigned char text[] = {'E', 'M', 'H'};
+    entry.setBytes(SmlBytesView{text, sizeof(text)});
+    EXPECT_TRUE(entry.isString());
+    EXPECT_EQ(entry.sValue().materialize(), "EMH");
+    EXPECT_EQ(entry.iValue(), 0u);
+    EXPECT_EQ(entry.value(), 0.0);
+
+    // lengths beyond 16 bits are refused instead of truncated
+    const std::vector<unsigned char> huge(70000, 0x5a);
+    EXPECT_FALSE(entry.setBytes(SmlBytesView{huge.data(), huge.size()}));
+    EXPECT_EQ(entry.type(), SmlValueType::None);
+    EXPECT_TRUE(entry.sValue().empty());
+    EXPECT_TRUE(entry.setSignature(SmlBytesView{text, sizeof(text)}));
+    EXPECT_FALSE(entry.setSignature(SmlBytesView{huge.data(), huge.size()}));
+    EXPECT_TRUE(entry.signature().empty());
+
+    // the parser skips such a value, TL bytes for 70000 + 5 bytes
+    std::vector<unsigned char> data = {0x77, 0x07, 0x81, 0x81, 0xc7, 0x82,
+                                       0x05, 0xff, 0x01, 0x01, 0x01, 0x01,
+                                       0x81, 0x81, 0x81, 0x87, 0x05};
+    data.insert(data.end(), huge.begin(), huge.end());
+    data.push_back(0x01);
+    SmlParser parser(data.data(), data.size());
+    size_t position = 0;
+    SmlListEntry parsed =
+        parser.parseSmlListEntry(data.data(), data.size(), position);
+    EXPECT_EQ(parsed.obis(), OBIS_PUB_KEY);
+    EXPECT_EQ(parsed.type(), SmlValueType::None);
+    EXPECT_EQ(position, data.size());
+}
+
+TEST(smlTape, lazyListEntries) {
+    // start sequence, one GetList.Res with two entries, end sequence
+    std::vector<unsigned char> frame = {
+        0x1b, 0x1b, 0x1b, 0x1b, 0x01, 0x01, 0x01, 0x01,
+        0x76, 0x02, 0x01, 0x62, 0x00, 0x62, 0x00,
+        0x72, 0x63, 0x07, 0x01,
+        0x77, 0x01, 0x03, 0x0a, 0x0b, 0x01, 0x01,
+        0x72,
+        0x77, 0x07, 0x01, 0x00, 0x01, 0x08, 0x00, 0xff, 0x01, 0x01,
+        0x62, 0x1e, 0x52, 0xff, 0x64, 0x01, 0x02, 0x03, 0x01,
+        0x77, 0x07, 0x01, 0x00, 0x10, 0x07, 0x00, 0xff, 0x01, 0x01,
+        0x62, 0x1b, 0x52, 0x00, 0x53, 0xfe, 0x38, 0x03, 0x5a, 0x5a,
+        0x01, 0x01,
+        0x63, 0x00, 0x00, 0x00,
+        0x1b, 0x1b, 0x1b, 0x1b, 0x1a, 0x00};
+    SmlCrc16 crc;
+    crc.update(frame.data(), frame.size());
+    frame.push_back(static_cast<unsigned char>(crc.final() >> 8));
+    frame.push_back(static_cast<unsigned char>(crc.final() & 0xff));
+
+    SmlTape tape;
+    ASSERT_EQ(tape.build(frame.data(), frame.size()), SML_OK);
+    ASSERT_EQ(tape.getListEntryCount(), 2u);
+
+    SmlTapeEntry energy = tape.getElementByObis(OBIS_TOTAL_ENERGY);
+    ASSERT_TRUE(energy.isValid());
+    EXPECT_EQ(energy.unit(), 0x1e);
+    EXPECT_DOUBLE_EQ(energy.value(), 6605.1);
+
+    SmlTapeEntry power = tape.getListEntry(1);
+    EXPECT_EQ(power.obis(), OBIS_SUM_ACT_INST_PWR);
+    EXPECT_EQ(power.decode().value(), -456.0);
+    EXPECT_EQ(power.signature().size(), 2u);
+
+    EXPECT_FALSE(tape.getElementByObis(OBIS_ENERGY_T1).isValid());
+
+    frame[frame.size() - 1] ^= 0x01;
+    EXPECT_EQ(tape.build(frame.data(), frame.size()), SML_ERROR_CRC);
+}
+
+// Several frames with line noise, a frame with a broken transport CRC and
+// the start of a cut off frame; offsets receives where each frame starts
+static std::vector<unsigned char> buildCapture(std::vector<size_t> &offsets,
+                                               const uint32_t frames) {
+    const std::vector<unsigned char> noise = {0x1b, 0x1b, 0x1b, 0x00,
+                                              0x1b, 0x1b, 0x1b, 0x1b,
+                                              0x01, 0x01, 0x01, 0x02};
+    std::vector<unsigned char> capture(noise.begin(), noise.end());
+    for (uint32_t i = 1; i <= frames; ++i) {
+        std::vector<unsigned char> frame = buildFrame(i);
+        if (i % 3 == 0) {
+            frame.back() ^= 0xff;
+        }
+        offsets.push_back(capture.size());
+        capture.insert(capture.end(), frame.begin(), frame.end());
+        capture.insert(capture.end(), noise.begin(),
+                       noise.begin() + static_cast<std::ptrdiff_t>(i % 13));
+    }
+    capture.insert(capture.end(), SML_START_SEQUENCE,
+                   SML_START_SEQUENCE + SML_START_SEQUENCE_LENGTH - 1);
+    return capture;
+}
+
+TEST(smlParser, parseNextWalksAllFrames) {
+    std::vector<size_t> offsets;
+    std::vector<unsigned char> capture = buildCapture(offsets, 7);
+
+    SmlParser parser(capture.data(), capture.size());
+    for (int pass = 0; pass < 2; ++pass) {
+        for (uint32_t i = 1; i <= offsets.size(); ++i) {
+            ASSERT_TRUE(parser.hasNext());
+            const sml_error_t result = parser.parseNext();
+            EXPECT_EQ(parser.getFrameOffset(), offsets[i - 1]);
+            if (i % 3 == 0) {
+                EXPECT_EQ(result, SML_ERROR_CRC) << "frame " << i;
+                continue;
+            }
+            ASSERT_EQ(result, SML_OK) << "frame " << i;
+            EXPECT_EQ(parser.getElementByObis(OBIS_TOTAL_ENERGY).iValue(), i);
+            EXPECT_EQ(parser.getSensorTime().timeValue, 1000u);
+        }
+        EXPECT_FALSE(parser.hasNext());
+        EXPECT_EQ(parser.parseNext(), SML_END_OF_DATA);
+        parser.rewind();
+    }
+}
+
+TEST(smlBulkParser, framesInInputOrder) {
+    std::vector<size_t> offsets;
+    const std::vector<unsigned char> capture = buildCapture(offsets, 300);
+
+    // chunks of a few frames, so many frames straddle a nominal cut
+    for (const unsigned threads : {1u, 4u}) {
+        SmlBulkParser bulk(threads, 300);
+        std::vector<SmlBulkFrame> frames;
+        const size_t count = bulk.parse(
+            capture.data(), capture.size(),
+            [&frames](const SmlBulkFrame &frame) { frames.push_back(frame); });
+
+        ASSERT_EQ(count, offsets.size());
+        ASSERT_EQ(frames.size(), offsets.size());
+        for (uint32_t i = 1; i <= frames.size(); ++i) {
+            const SmlBulkFrame &frame = frames[i - 1];
+            EXPECT_EQ(frame.offset, offsets[i - 1]);
+            if (i % 3 == 0) {
+                EXPECT_EQ(frame.result, SML_ERROR_CRC) << "frame " << i;
+                EXPECT_TRUE(frame.entries.empty());
+                continue;
+            }
+            ASSERT_EQ(frame.result, SML_OK) << "frame " << i;
+            EXPECT_EQ(frame.sensorTime.timeValue, 1000u);
+            ASSERT_EQ(frame.entries.size(), 1u);
+            EXPECT_EQ(frame.entries[0].obis(), OBIS_TOTAL_ENERGY);
+            EXPECT_EQ(frame.entries[0].iValue(), i);
+        }
+    }
+
+    SmlBulkParser bulk(2, 64);
+    size_t calls = 0;
+    EXPECT_EQ(bulk.parse(capture.data(), SML_START_SEQUENCE_LENGTH - 1,
+                         [&calls](const SmlBulkFrame &) { ++calls; }),
+              0u);
+    EXPECT_EQ(calls, 0u);
+}
+
+TEST(smlBulkParser, handlerThrows) {
+    std::vector<size_t> offsets;
+    const std::vector<unsigned char> capture = buildCapture(offsets, 300);
+
+    // the workers are joined while the exception unwinds, no terminate
+    for (const size_t stopAt : {size_t{0}, size_t{5}, offsets.size() - 1}) {
+        SmlBulkParser bulk(4, 300);
+        size_t calls = 0;
+        EXPECT_THROW(bulk.parse(capture.data(), capture.size(),
+                                [&](const SmlBulkFrame &) {
+                                    if (calls++ == stopAt) {
+                                        throw std::runtime_error("stop");
+                                    }
+                                }),
+                     std::runtime_error);
+        EXPECT_EQ(calls, stopAt + 1);
+    }
+}
+
+TEST(smlVarint, zigzagDeltaOfDeltaRoundTrip) {
+    EXPECT_EQ(sml_zigzag_encode(0), 0u);
+    EXPECT_EQ(sml_zigzag_encode(-1), 1u);
+    EXPECT_EQ(sml_zigzag_encode(1), 2u);
+    EXPECT_EQ(sml_zigzag_decode(sml_zigzag_encode(INT64_MIN)), INT64_MIN);
+
+    const int64_t series[] = {1000, 1002, 1004, 1007, -5, INT64_MAX,
+                              INT64_MIN, 0};
+    SmlDeltaOfDelta encoder;
+    SmlDeltaOfDelta decoder;
+    uint8_t buffer[sizeof(series) / sizeof(series[0]) * SML_VARINT_MAX_LENGTH];
+    size_t length = 0;
+    for (const int64_t value : series) {
+        length += sml_varint_encode(sml_zigzag_encode(encoder.encode(value)),
+                                    &buffer[length]);
+    }
+    // steady steps cost a single byte
+    EXPECT_EQ(buffer[3], 0x00);
+
+    size_t position = 0;
+    for (const int64_t value : series) {
+        uint64_t raw = 0;
+        ASSERT_TRUE(sml_varint_decode(buffer, length, position, raw));
+        EXPECT_EQ(decoder.decode(sml_zigzag_decode(raw)), value);
+    }
+    EXPECT_EQ(position, length);
+
+    uint64_t raw = 0;
+    const uint8_t truncated[] = {0x80, 0x80};
+    position = 0;
+    EXPECT_FALSE(sml_varint_decode(truncated, sizeof(truncated), position, raw));
+    EXPECT_EQ(position, 0u);
+}
+
+static SmlListEntry makeEntry(const ObisCode obis, const int8_t scaler,
+                              const int64_t value, const uint64_t status) {
+    unsigned char name[6];
+    for (size_t i = 0; i < sizeof(name); ++i) {
+        name[i] = obis.byte(i);
+    }
+    SmlListEntry entry;
+    entry.setObjName(SmlBytesView{name, sizeof(name)});
+    entry.setUnit(0x1e);
+    entry.setScaler(scaler);
+    entry.setInteger(value);
+    entry.setStatus(status);
+    return entry;
+}
+
+TEST(smlColumnStore, roundTrip) {
+    // energy fills a block and changes its scaler, power every fourth frame
+    const size_t energySamples = SmlColumnWriter::BLOCK_SAMPLES + 10;
+    std::vector<std::pair<SmlColumnSample, int8_t>> energy;
+    std::vector<SmlColumnSample> power;
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    {
+        SmlColumnWriter writer(file);
+        for (size_t i = 0; i < energySamples + 5; ++i) {
+            const uint32_t time = static_cast<uint32_t>(1000 + 2 * i + i % 3);
+            const int8_t scaler = i < energySamples ? -1 : 0;
+            const SmlColumnSample sample{
+                time, static_cast<int64_t>(100000 + i * i % 7),
+                0x00070104u + (i % 50 == 0)};
+            writer.append(time, makeEntry(OBIS_TOTAL_ENERGY, scaler,
+                                          sample.value, sample.status));
+            energy.emplace_back(sample, scaler);
+            if (i % 4 == 0) {
+                const SmlColumnSample reading{
+                    time, -static_cast<int64_t>(i % 500), 0};
+                writer.append(time, makeEntry(OBIS_SUM_ACT_INST_PWR, 0,
+                                              reading.value, 0));
+                power.push_back(reading);
+            }
+        }
+        ASSERT_TRUE(writer.flush());
+    }
+    std::vector<unsigned char> data(static_cast<size_t>(ftell(file)));
+    rewind(file);
+    ASSERT_EQ(fread(data.data(), 1, data.size(), file), data.size());
+    fclose(file);
+
+    SmlColumnReader reader(data.data(), data.size());
+    ASSERT_TRUE(reader.isValid());
+    const std::vector<SmlColumnInfo> columns = reader.getColumns();
+    ASSERT_EQ(columns.size(), 3u);
+    EXPECT_EQ(columns[0].obis, OBIS_TOTAL_ENERGY);
+    EXPECT_EQ(columns[0].scaler, -1);
+    EXPECT_EQ(columns[0].count, energySamples);
+    EXPECT_EQ(columns[1].obis, OBIS_TOTAL_ENERGY);
+    EXPECT_EQ(columns[1].scaler, 0);
+    EXPECT_EQ(columns[1].count, 5u);
+    EXPECT_EQ(columns[2].obis, OBIS_SUM_ACT_INST_PWR);
+    EXPECT_EQ(columns[2].count, power.size());
+
+    size_t index = 0;
+    auto checkEnergy = [&](const SmlColumnBlock &block,
+                           const SmlColumnSample &sample) {
+        ASSERT_LT(index, energy.size());
+        EXPECT_EQ(sample.time, energy[index].first.time);
+        EXPECT_EQ(sample.value, energy[index].first.value);
+        EXPECT_EQ(sample.status, energy[index].first.status);
+        EXPECT_EQ(block.scaler, energy[index].second);
+        EXPECT_EQ(block.unit, 0x1e);
+        ++index;
+    };
+    EXPECT_EQ(reader.scanColumn(OBIS_TOTAL_ENERGY, checkEnergy), energy.size());
+
+    index = 0;
+    auto checkPower = [&](const SmlColumnBlock &,
+                          const SmlColumnSample &sample) {
+        ASSERT_LT(index, power.size());
+        EXPECT_EQ(sample.time, power[index].time);
+        EXPECT_EQ(sample.value, power[index].value);
+        ++index;
+    };
+    EXPECT_EQ(reader.scanColumn(OBIS_SUM_ACT_INST_PWR, checkPower),
+              power.size());
+    EXPECT_EQ(reader.scanColumn(OBIS_ENERGY_T1, checkPower), 0u);
+
+    // the power block comes last, cut off it is left out
+    SmlColumnReader truncated(data.data(), data.size() - 1);
+    EXPECT_EQ(truncated.scanColumn(OBIS_SUM_ACT_INST_PWR, checkPower), 0u);
+    EXPECT_EQ(truncated.getColumns().size(), 2u);
+    EXPECT_FALSE(SmlColumnReader(data.data(), 4).isValid());
+}
+
+TEST(smlColumnStore, valTimeOfParsedEntries) {
+    const std::vector<std::vector<unsigned char>> entries = {
+        withValTime(listEntry(OBIS_TOTAL_ENERGY, 0x1e, -1, 1000), 2,
+                    0x5f5e1000),
+        listEntry(OBIS_SUM_ACT_INST_PWR, 0x1b, 0, -250),
+    };
+    SmlParser parser(nullptr, 0);
+    SmlGetListRes res;
+    const std::vector<unsigned char> body = getListBody(entries);
+    size_t position = 4;
+    parser.parseSmlGetListRes(body.data(), body.size(), position, res);
+    ASSERT_EQ(res.valList.size(), entries.size());
+    ASSERT_EQ(res.actSensorTime.timeValue, 1000u);
+
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    {
+        SmlColumnWriter writer(file);
+        writer.append(res.actSensorTime, res.valList);
+        ASSERT_TRUE(writer.flush());
+    }
+    std::vector<unsigned char> data(static_cast<size_t>(ftell(file)));
+    rewind(file);
+    ASSERT_EQ(fread(data.data(), 1, data.size(), file), data.size());
+    fclose(file);
+
+    // the entry's own valTime wins over actSensorTime
+    SmlColumnReader reader(data.data(), data.size());
+    ASSERT_TRUE(reader.isValid());
+    std::vector<SmlColumnSample> samples;
+    auto collect = [&](const SmlColumnBlock &, const SmlColumnSample &sample) {
+        samples.push_back(sample);
+    };
+    ASSERT_EQ(reader.scanColumn(OBIS_TOTAL_ENERGY, collect), 1u);
+    EXPECT_EQ(samples[0].time, 0x5f5e1000u);
+    EXPECT_EQ(samples[0].value, 1000);
+    ASSERT_EQ(reader.scanColumn(OBIS_SUM_ACT_INST_PWR, collect), 1u);
+    EXPECT_EQ(samples[1].time, 1000u);
+    EXPECT_EQ(samples[1].value, -250);
+}
+
+TEST(smlHistory, ringQueriesAndEviction) {
+    alignas(std::max_align_t) unsigned char storage[256];
+    SmlHistory history(storage, sizeof(storage), OBIS_TOTAL_ENERGY, 32);
+    ASSERT_TRUE(history.isValid());
+
+    SmlHistorySample samples[4];
+    EXPECT_EQ(history.getLast(samples), 0u);
+
+    // a steady counter every 300 s, far more than fits
+    for (uint32_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(history.append(1000 + i * 300, 50000 + i * 7));
+    }
+    const size_t held = history.size();
+    EXPECT_GT(held, 10u);
+    EXPECT_LT(held, 1000u);
+
+    ASSERT_EQ(history.getLast(samples), 4u);
+    EXPECT_EQ(samples[3].time, 1000u + 999 * 300);
+    EXPECT_EQ(samples[3].value, 50000 + 999 * 7);
+    EXPECT_EQ(samples[0].time, 1000u + 996 * 300);
+
+    const uint32_t from = 1000 + 990 * 300;
+    ASSERT_EQ(history.getRange(from, from + 300, samples), 2u);
+    EXPECT_EQ(samples[0].value, 50000 + 990 * 7);
+    EXPECT_EQ(samples[1].value, 50000 + 991 * 7);
+
+    // a second history over the same storage continues the first one
+    SmlHistory again(storage, sizeof(storage), OBIS_TOTAL_ENERGY, 32);
+    EXPECT_EQ(again.size(), held);
+    SmlHistory other(storage, sizeof(storage), OBIS_SUM_ACT_INST_PWR, 32);
+    EXPECT_EQ(other.size(), 0u);
+
+    unsigned char tiny[8];
+    EXPECT_FALSE(SmlHistory(tiny, sizeof(tiny), OBIS_TOTAL_ENERGY).isValid());
+}
+
+TEST(smlPublishPolicy, deadbandAndHeartbeat) {
+    static constexpr SmlDeadband rules[] = {
+        {OBIS_TOTAL_ENERGY, 10.0, 0.0, 3600},
+        {OBIS_SUM_ACT_INST_PWR, 5.0, 0.1, 0},
+    };
+    SmlPublishState states[std::size(rules)];
+    SmlPublishPolicy policy(rules, states);
+
+    // nothing published yet
+    EXPECT_TRUE(policy.isDue(OBIS_TOTAL_ENERGY, 1000.0, 0));
+    policy.setPublished(OBIS_TOTAL_ENERGY, 1000.0, 0);
+    EXPECT_FALSE(policy.isDue(OBIS_TOTAL_ENERGY, 1010.0, 300));
+    EXPECT_TRUE(policy.isDue(OBIS_TOTAL_ENERGY, 1010.5, 300));
+    EXPECT_TRUE(policy.isDue(OBIS_TOTAL_ENERGY, 1000.0, 3600));
+
+    // the relative band wins for large values
+    policy.setPublished(OBIS_SUM_ACT_INST_PWR, 2000.0, 0);
+    EXPECT_FALSE(policy.isDue(OBIS_SUM_ACT_INST_PWR, 2150.0, 100000));
+    EXPECT_TRUE(policy.isDue(OBIS_SUM_ACT_INST_PWR, 1750.0, 100000));
+
+    // codes without a rule always go out
+    EXPECT_TRUE(policy.isDue(OBIS_SUM_ACT_INST_PWR_L1, 1.0, 0));
+
+    // the state carries over, a changed rule table resets it
+    SmlPublishPolicy again(rules, states);
+    EXPECT_FALSE(again.isDue(OBIS_TOTAL_ENERGY, 1000.0, 300));
+    static constexpr SmlDeadband swapped[] = {rules[1], rules[0]};
+    SmlPublishPolicy changed(swapped, states);
+    EXPECT_TRUE(changed.isDue(OBIS_TOTAL_ENERGY, 1000.0, 300));
+}
+
+TEST(smlPayload, decimalJsonAndCbor) {
+    char text[SML_DECIMAL_MAX_LENGTH];
+    EXPECT_EQ(std::string(text, sml_format_decimal(123456, false, -1, text)),
+              "12345.6");
+    EXPECT_EQ(std::string(text, sml_format_decimal(5, true, -3, text)),
+              "-0.005");
+    EXPECT_EQ(std::string(text, sml_format_decimal(7, false, 2, text)), "700");
+    EXPECT_EQ(std::string(text, sml_format_decimal(12, false, 12, text)),
+              "12e12");
+
+    char buffer[48];
+    SmlPayloadWriter json(buffer, sizeof(buffer));
+    json.begin(1234);
+    EXPECT_TRUE(json.add("totalEnergy", 123456, false, -1));
+    EXPECT_TRUE(json.add("power", 250, true, 0));
+    // does not fit, the document stays complete without it
+    EXPECT_FALSE(json.add("instantPowerL1", 1, false, 0));
+    EXPECT_TRUE(json.finish());
+    EXPECT_EQ(std::string(json.data(), json.size()),
+              "{\"time\":1234,\"totalEnergy\":12345.6,\"power\":-250}");
+
+    SmlPayloadWriter cbor(buffer, sizeof(buffer), SmlPayloadFormat::Cbor);
+    cbor.begin(1234);
+    cbor.add("e", 123456, false, -1);
+    cbor.add("p", 250, true, 0);
+    EXPECT_TRUE(cbor.finish());
+    const std::vector<unsigned char> expected{
+        0xbf, 0x64, 't',  'i',  'm',  'e',  0x19, 0x04, 0xd2, 0x61, 'e', 0xc4,
+        0x82, 0x20, 0x1a, 0x00, 0x01, 0xe2, 0x40, 0x61, 'p',  0x38, 0xf9, 0xff};
+    EXPECT_EQ(std::vector<unsigned char>(cbor.data(), cbor.data() + cbor.size()),
+              expected);
+}
+
+TEST(smlTopicMap, namesAndIdsFromObis) {
+    char name[ObisCode::NAME_LENGTH];
+    EXPECT_EQ(OBIS_TOTAL_ENERGY.formatName(name), 9u);
+    EXPECT_STREQ(name, "1-0:1.8.0");
+    "1-0:1.8.0*1"_obis.formatName(name);
+    EXPECT_STREQ(name, "1-0:1.8.0*1");
+
+    struct Registry {
+        std::vector<std::string> topics;
+        uint16_t addTopic(const char *topic) {
+            topics.push_back(std::string("meter/") + topic);
+            return static_cast<uint16_t>(topics.size() - 1);
+        }
+    } registry;
+
+    SmlTopicMap<2> map;
+    EXPECT_EQ(map.add(OBIS_TOTAL_ENERGY, registry), 0u);
+    EXPECT_EQ(map.add(OBIS_SUM_ACT_INST_PWR, registry), 1u);
+    // known codes keep their topic, the map is full for new ones
+    EXPECT_EQ(map.add(OBIS_TOTAL_ENERGY, registry), 0u);
+    EXPECT_EQ(map.add(OBIS_SUM_ACT_INST_PWR_L1, registry),
+              SmlTopicMap<2>::NO_TOPIC);
+    EXPECT_EQ(registry.topics.size(), 2u);
+    EXPECT_EQ(registry.topics[1], "meter/1-0:16.7.0");
+
+    EXPECT_EQ(map.getTopic(OBIS_SUM_ACT_INST_PWR), 1u);
+    EXPECT_STREQ(map.getName(OBIS_TOTAL_ENERGY), "1-0:1.8.0");
+    EXPECT_EQ(map.getName(OBIS_SUM_ACT_INST_PWR_L1), nullptr);
+}